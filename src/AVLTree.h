@@ -32,19 +32,32 @@ private:
 		}
 	}
 
-	// For building a words index
-	void insert(string& new_data, string paper_id, Node*& curr) {
+	// Adds count positions to a word, or drops the positions of the word if the documents they come with don't have them
+	void add_positions(Node* curr, bool has_positions, const uint32_t* positions, int count) {
+		if (!has_positions) {
+			curr->has_positions = false;
+			vector<uint32_t>().swap(curr->position_list);
+		}
+		else if (curr->has_positions) {
+			curr->position_list.insert(curr->position_list.end(), positions, positions + count);
+		}
+	}
+
+	// For building a words index, positions holds the freq positions of the word in the document, or is nullptr
+	void insert(string& new_data, DocId doc, uint32_t freq, const uint32_t* positions, Node*& curr) {
 
 		if (curr == nullptr) {
 			curr = new Node(new_data, nullptr, nullptr);
-			curr->id_list.push_back(paper_id);
+			curr->id_list.push_back(doc);
+			curr->freq_list.push_back(freq);
+			add_positions(curr, positions != nullptr, positions, freq);
 			words.push_back(curr);
 			// Only increment word count when creating a new word to avoid double counting for duplicates
 			num_unique_words += 1; 
 		}
 
 		else if (new_data < curr->data) {
-			insert(new_data, paper_id, curr->left);    // recurrsive call
+			insert(new_data, doc, freq, positions, curr->left);    // recurrsive call
 			if (get_height(curr->left) - get_height(curr->right) == 2) {
 				if (new_data < curr->left->data) {
 					rotate_with_left_child(curr);      // Case 1 rotation (LeftLeft rotation)
@@ -56,7 +69,7 @@ private:
 		}
 
 		else if (new_data > curr->data) {
-			insert(new_data, paper_id, curr->right);	   // recurrsive call
+			insert(new_data, doc, freq, positions, curr->right);	   // recurrsive call
 			if (get_height(curr->right) - get_height(curr->left) == 2) {
 				if (new_data > curr->right->data) {
 					rotate_with_right_child(curr);   // Case 4 rotation (RightRight rotation)
@@ -67,9 +80,11 @@ private:
 			}
 		}
 
-		// The same word already exists, only push_back its paper id
+		// The same word already exists, only push_back its document id
 		else if (new_data == curr->data) {
-			curr->id_list.push_back(paper_id);
+			curr->id_list.push_back(doc);
+			curr->freq_list.push_back(freq);
+			add_positions(curr, positions != nullptr, positions, freq);
 			curr->count += 1;
 			return;
 		}
@@ -79,6 +94,57 @@ private:
 	}
 
 
+	// For merging a partial words index, appends a whole list of document ids (and their term frequencies and positions, if
+	// has_positions) to the word at once
+	void insert(string& new_data, vector<DocId>& doc_ids, vector<uint32_t>& freqs, vector<uint32_t>& positions, bool has_positions, Node*& curr) {
+
+		if (curr == nullptr) {
+			curr = new Node(new_data, nullptr, nullptr);
+			curr->id_list = doc_ids;
+			curr->freq_list = freqs;
+			add_positions(curr, has_positions, positions.data(), positions.size());
+			curr->count = doc_ids.size();
+			words.push_back(curr);
+			num_unique_words += 1;
+		}
+
+		else if (new_data < curr->data) {
+			insert(new_data, doc_ids, freqs, positions, has_positions, curr->left);    // recurrsive call
+			if (get_height(curr->left) - get_height(curr->right) == 2) {
+				if (new_data < curr->left->data) {
+					rotate_with_left_child(curr);      // Case 1 rotation (LeftLeft rotation)
+				}
+				else {
+					double_with_left_child(curr);	   // Case 2 rotation (RightLeft rotation)
+				}
+			}
+		}
+
+		else if (new_data > curr->data) {
+			insert(new_data, doc_ids, freqs, positions, has_positions, curr->right);	   // recurrsive call
+			if (get_height(curr->right) - get_height(curr->left) == 2) {
+				if (new_data > curr->right->data) {
+					rotate_with_right_child(curr);   // Case 4 rotation (RightRight rotation)
+				}
+				else {
+					double_with_right_child(curr);   // Case 3 rotation (LeftRight rotation)
+				}
+			}
+		}
+
+		// The same word already exists, append the document ids after the ones already there
+		else if (new_data == curr->data) {
+			curr->id_list.insert(curr->id_list.end(), doc_ids.begin(), doc_ids.end());
+			curr->freq_list.insert(curr->freq_list.end(), freqs.begin(), freqs.end());
+			add_positions(curr, has_positions, positions.data(), positions.size());
+			curr->count += doc_ids.size();
+			return;
+		}
+
+		curr->height = max(get_height(curr->left), get_height(curr->right)) + 1;
+	}
+
+
 	// For building a stop word tree
 	void insert(string& new_data, Node*& curr) {
 
@@ -153,15 +219,64 @@ private:
 	}
 
 
-	// Print all the words and the papper_ids each word appeared in
+	// Appends all the document ids of a word to doc_ids, the sealed ones first and then the ones added after them
+	void get_all_doc_ids(Node* curr, vector<DocId>& doc_ids) {
+		curr->postings.decode(doc_ids);
+		doc_ids.insert(doc_ids.end(), curr->id_list.begin(), curr->id_list.end());
+	}
+
+	// Appends all the document ids of a word, their term frequencies and, if the word has them, their positions, in the same
+	// order as get_all_doc_ids()
+	void get_all_postings(Node* curr, vector<DocId>& doc_ids, vector<uint32_t>& freqs, vector<uint32_t>& positions) {
+		curr->postings.decode(doc_ids, freqs, positions);
+		doc_ids.insert(doc_ids.end(), curr->id_list.begin(), curr->id_list.end());
+		freqs.insert(freqs.end(), curr->freq_list.begin(), curr->freq_list.end());
+		positions.insert(positions.end(), curr->position_list.begin(), curr->position_list.end());
+	}
+
+	// Compresses the document ids added to a word since it was last sealed into its PostingList
+	void seal(Node* curr) {
+		if (curr->id_list.empty()) {
+			return;
+		}
+
+		vector<DocId> doc_ids;
+		vector<uint32_t> freqs, positions;
+		get_all_postings(curr, doc_ids, freqs, positions);
+		if (!curr->has_positions) {
+			positions.clear();
+		}
+		// Restoring the index on top of an index that wasn't cleared adds the ids out of order, sort them with their frequencies
+		// and positions
+		if (!is_sorted(doc_ids.begin(), doc_ids.end())) {
+			sort_postings(doc_ids, freqs, positions);
+		}
+		curr->postings.encode(doc_ids, freqs, positions);
+		vector<DocId>().swap(curr->id_list);
+		vector<uint32_t>().swap(curr->freq_list);
+		vector<uint32_t>().swap(curr->position_list);
+	}
+
+	Node* find(string& word) {
+		Node* curr = root;
+		while (curr != nullptr && curr->data != word) {
+			curr = (word < curr->data) ? curr->left : curr->right;
+		}
+		return curr;
+	}
+
+
+	// Print all the words and the document ids each word appeared in
 	void inorderTraversal(Node* curr) {
 		if (curr != nullptr) {
 			inorderTraversal(curr->left);
 
 			cout << curr->data << endl;
-			cout << "paper_ids: " << endl;
-			for (int i = 0; i < curr->id_list.size(); i += 1) {
-				cout << curr->id_list.at(i) << endl;
+			cout << "document ids: " << endl;
+			vector<DocId> doc_ids;
+			get_all_doc_ids(curr, doc_ids);
+			for (int i = 0; i < doc_ids.size(); i += 1) {
+				cout << doc_ids.at(i) << endl;
 			}
 
 			inorderTraversal(curr->right);
@@ -169,22 +284,20 @@ private:
 	}
 
 
-	void get_paper_ids(string search_term, vector<string>& paper_ids, Node* curr) {
+	bool get_doc_ids(string search_term, vector<DocId>& doc_ids, Node* curr) {
 		if (curr == nullptr) {
-			cout << "search term not found." << endl << endl;
+			return false;
 		}
 
 		else if (search_term < curr->data) {
-			get_paper_ids(search_term, paper_ids, curr->left);
+			return get_doc_ids(search_term, doc_ids, curr->left);
 		}
 		else if (search_term > curr->data) {
-			get_paper_ids(search_term, paper_ids, curr->right);
+			return get_doc_ids(search_term, doc_ids, curr->right);
 		}
-		else if (search_term == curr->data) {
-			for (int i = 0; i < curr->id_list.size(); i += 1) {
-				paper_ids.push_back(curr->id_list.at(i));
-
-			}
+		else {
+			get_all_doc_ids(curr, doc_ids);
+			return curr->postings.size() > 0 || !curr->id_list.empty();
 		}
 	}
 
@@ -215,8 +328,6 @@ private:
 			clear_tree(curr->right);
 			//cout << "deleting node: " << curr->data << endl;
 			delete curr;
-			curr->left = nullptr;
-			curr->right = nullptr;
 		}
 		root = nullptr;
 		words.clear();
@@ -226,22 +337,48 @@ private:
 	}
 
 
-	// This function uses In-order Traversal to wirte the AVLTree to a textfile 
-	void write_to_file(Node* curr, ofstream& index_ofs) {
+	// Links the nodes words[begin, end), which are sorted, into a perfectly balanced subtree and returns its root
+	Node* link_balanced(int begin, int end) {
+		if (begin >= end) {
+			return nullptr;
+		}
+		int mid = begin + (end - begin) / 2;
+		Node* curr = words.at(mid);
+		curr->left = link_balanced(begin, mid);
+		curr->right = link_balanced(mid + 1, end);
+		curr->height = max(get_height(curr->left), get_height(curr->right)) + 1;
+		return curr;
+	}
+
+
+	// In-order Traversal, collects the nodes sorted by their words
+	void get_sorted_words(Node* curr, vector<Node*>& sorted_words) {
+		if (curr != nullptr) {
+			get_sorted_words(curr->left, sorted_words);
+			sorted_words.push_back(curr);
+			get_sorted_words(curr->right, sorted_words);
+		}
+	}
+
+
+	// This function uses In-order Traversal to wirte the AVLTree to a textfile, the document ids are written as their paper ids
+	void write_to_file(Node* curr, ofstream& index_ofs, DocumentTable& doc_table) {
 		
 		if (curr != nullptr) {
 
-			write_to_file(curr->left, index_ofs);
+			write_to_file(curr->left, index_ofs, doc_table);
 
 			if (curr->data != "") {
 				index_ofs << curr->data << endl;
 
-				for (int i = 0; i < curr->id_list.size(); i += 1) {
-					index_ofs << curr->id_list.at(i) << endl;
+				vector<DocId> doc_ids;
+				get_all_doc_ids(curr, doc_ids);
+				for (int i = 0; i < doc_ids.size(); i += 1) {
+					index_ofs << doc_table.get_paper_id(doc_ids.at(i)) << endl;
 				}
 			}
 
-			write_to_file(curr->right, index_ofs);
+			write_to_file(curr->right, index_ofs, doc_table);
 		}
 	}
 
@@ -254,8 +391,41 @@ public:
 		root = nullptr;
 	}
 
-	void insert(string data, string paper_id) {
-		insert(data, paper_id, root); 				// calls the private version of the insert function, restrict the public interface to the user
+	// The positions of the i-th document start at starts.at(i)
+	static vector<size_t> position_starts(vector<uint32_t>& freqs) {
+		vector<size_t> starts(freqs.size() + 1, 0);
+		for (int i = 0; i < freqs.size(); i += 1) {
+			starts.at(i + 1) = starts.at(i) + freqs.at(i);
+		}
+		return starts;
+	}
+
+	// Sorts the postings of a word by document id, with their frequencies and positions (empty if the word has none)
+	static void sort_postings(vector<DocId>& doc_ids, vector<uint32_t>& freqs, vector<uint32_t>& positions) {
+		vector<size_t> starts = position_starts(freqs);
+		vector<pair<DocId, int>> order;
+		for (int i = 0; i < doc_ids.size(); i += 1) {
+			order.push_back(make_pair(doc_ids.at(i), i));
+		}
+		sort(order.begin(), order.end());
+
+		vector<uint32_t> sorted_freqs, sorted_positions;
+		for (int i = 0; i < order.size(); i += 1) {
+			int j = order.at(i).second;
+			doc_ids.at(i) = order.at(i).first;
+			sorted_freqs.push_back(freqs.at(j));
+			if (!positions.empty()) {
+				sorted_positions.insert(sorted_positions.end(), positions.begin() + starts.at(j), positions.begin() + starts.at(j + 1));
+			}
+		}
+		freqs = sorted_freqs;
+		positions = sorted_positions;
+	}
+
+
+	// positions holds the freq positions of the word in the document, without them the word loses its positions
+	void insert(string data, DocId doc, uint32_t freq = 1, const uint32_t* positions = nullptr) {
+		insert(data, doc, freq, positions, root); 				// calls the private version of the insert function, restrict the public interface to the user
 	}
 
 	// For stop words
@@ -263,14 +433,143 @@ public:
 		insert(data, root);
 	}
 
+	// Replaces the tree by a perfectly balanced tree of the given words, which have to be sorted and unique, each with its posting 
+	// list (which is moved into its node). The middle word is the root, so the tree is built in linear time without any rotation,
+	// instead of inserting the words one by one
+	void build(vector<string>& sorted_words, vector<PostingList>& postings) {
+		clear_tree();
+		for (int i = 0; i < sorted_words.size(); i += 1) {
+			Node* curr = new Node(sorted_words.at(i), nullptr, nullptr);
+			curr->postings = move(postings.at(i));
+			curr->count = curr->postings.size();
+			curr->has_positions = curr->postings.has_positions();
+			words.push_back(curr);
+		}
+		root = link_balanced(0, words.size());
+		num_unique_words = words.size();
+	}
+
+	// For restoring a word with its whole posting list, e.g. a view on an index file
+	void insert(string data, const PostingList& postings) {
+		vector<DocId> no_ids;
+		vector<uint32_t> no_freqs;
+		insert(data, no_ids, no_freqs, no_freqs, true, root);
+		Node* curr = find(data);
+		curr->postings = postings;
+		curr->count = postings.size();
+		curr->has_positions = curr->has_positions && postings.has_positions();
+	}
+
 
 	void inorderTraversal() {
 		inorderTraversal(root);			  		    // calls the private version of the traversal function
 	}
 
 
-	void get_paper_ids(string search_term, vector<string>& paper_ids) {
-		get_paper_ids(search_term, paper_ids, root); 			// calls the private version of the get_paper_ids function
+	// Appends the document ids of a word to doc_ids, returns false if the word isn't in the index
+	bool get_doc_ids(string search_term, vector<DocId>& doc_ids) {
+		return get_doc_ids(search_term, doc_ids, root); 	// calls the private version of the get_doc_ids function
+	}
+
+
+	// Merges a partial index built from later articles into this tree. The words are visited in the order they were
+	// created in the partial tree so the result is the same as inserting those articles one by one
+	void merge(AVLTree& partial) {
+		vector<DocId> doc_ids;
+		vector<uint32_t> freqs, positions;
+		for (int i = 0; i < partial.words.size(); i += 1) {
+			doc_ids.clear();
+			freqs.clear();
+			positions.clear();
+			get_all_postings(partial.words.at(i), doc_ids, freqs, positions);
+			insert(partial.words.at(i)->data, doc_ids, freqs, positions, partial.words.at(i)->has_positions, root);
+		}
+	}
+
+
+	// Removes the deleted documents from the posting lists. A word left without documents stays in the tree with an empty list,
+	// it is dropped when the tree is written to an index file
+	void remove_docs(const LiveDocs& live_docs) {
+		vector<DocId> doc_ids;
+		vector<uint32_t> freqs, positions, kept_positions;
+		for (int i = 0; i < words.size(); i += 1) {
+			Node* curr = words.at(i);
+			doc_ids.clear();
+			freqs.clear();
+			positions.clear();
+			kept_positions.clear();
+			get_all_postings(curr, doc_ids, freqs, positions);
+			vector<size_t> starts = position_starts(freqs);
+
+			int kept = 0;
+			for (int j = 0; j < doc_ids.size(); j += 1) {
+				if (live_docs.is_live(doc_ids.at(j))) {
+					if (curr->has_positions) {
+						kept_positions.insert(kept_positions.end(), positions.begin() + starts.at(j), positions.begin() + starts.at(j + 1));
+					}
+					doc_ids.at(kept) = doc_ids.at(j);
+					freqs.at(kept) = freqs.at(j);
+					kept += 1;
+				}
+			}
+			if (kept == doc_ids.size()) {
+				continue;
+			}
+			doc_ids.resize(kept);
+			freqs.resize(kept);
+
+			curr->postings = PostingList();
+			curr->id_list = doc_ids;
+			curr->freq_list = freqs;
+			curr->position_list = kept_positions;
+			seal(curr);
+			curr->count = doc_ids.size();
+		}
+	}
+
+
+	// Compresses the document ids of every word into its PostingList, called once the index is built or restored.
+	// Words can still be inserted afterwards, their new ids wait in the node's id_list until the next seal
+	void seal() {
+		for (int i = 0; i < words.size(); i += 1) {
+			seal(words.at(i));
+		}
+	}
+
+
+	// Returns the sealed posting list of a word, or nullptr if the word isn't in the index
+	const PostingList* get_postings(string search_term) {
+		Node* curr = find(search_term);
+		if (curr == nullptr) {
+			return nullptr;
+		}
+		seal(curr);
+		// All the documents of the word were removed
+		if (curr->postings.size() == 0) {
+			return nullptr;
+		}
+		return &curr->postings;
+	}
+
+
+	// The number of bytes taken by the postings of all the words: their document ids, term frequencies and positions
+	long long get_postings_memory() {
+		long long total = 0;
+		for (int i = 0; i < words.size(); i += 1) {
+			total += words.at(i)->postings.memory_usage() + words.at(i)->id_list.capacity() * sizeof(DocId)
+				+ (words.at(i)->freq_list.capacity() + words.at(i)->position_list.capacity()) * sizeof(uint32_t);
+		}
+		return total;
+	}
+
+	// The number of bytes taken by the document ids alone, compressed (with the block tables) or not sealed yet. The ids of
+	// the lists restored from an index file are counted too, even if they are only in the mapped file
+	long long get_doc_ids_memory() {
+		long long total = 0;
+		for (int i = 0; i < words.size(); i += 1) {
+			total += words.at(i)->postings.get_freqs_offset() + words.at(i)->id_list.capacity() * sizeof(DocId);
+		}
+		return total;
 	}
 
 
@@ -284,6 +583,13 @@ public:
 		return words;
 	}
 
+	// The nodes sorted by their words
+	vector<Node*> get_sorted_words() {
+		vector<Node*> sorted_words;
+		get_sorted_words(root, sorted_words);
+		return sorted_words;
+	}
+
 
 	bool contain(string word) {
 		return contain(word, root);
@@ -294,8 +600,8 @@ public:
 		clear_tree(root);
 	}
 
-	void write_to_file(ofstream& index_ofs) {
-		write_to_file(root, index_ofs);
+	void write_to_file(ofstream& index_ofs, DocumentTable& doc_table) {
+		write_to_file(root, index_ofs, doc_table);
 	}
 
 };
@@ -37,6 +37,10 @@ public:
 	vector<string> get_authors() { return authors; };
 	vector<string> get_authors_last() { return authors_last; };
 	string get_text() { return body_text; };
+	string& get_text_ref() { return body_text; };
+
+	// Frees the body text once it has been indexed and moved to the DocumentStore
+	void release_text() { string().swap(body_text); };
 
 };
 
@@ -0,0 +1,97 @@
+#ifndef BM25_H
+#define BM25_H
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+
+// BM25 scores how relevant a document is to a search term from what the index already stores: the term frequency of the
+// posting, the number of documents the term appeared in (df) and the length of the document. A term that appears in fewer
+// documents weighs more (idf), repeating a term in a document helps less and less (k1 controls how fast the term frequency
+// saturates), and long documents are penalized relative to the average length (b = 0 doesn't look at the length, b = 1
+// fully normalizes by it).
+// A document where the search terms are close to each other is boosted on top of that, see proximity()
+class BM25 {
+
+public:
+	static constexpr double DEFAULT_K1 = 1.2;
+	static constexpr double DEFAULT_B = 0.75;
+	static constexpr double DEFAULT_PROXIMITY_WEIGHT = 1.0;
+
+private:
+	double k1;
+	double b;
+	// 0 turns the proximity boost off
+	double proximity_weight;
+
+	// The statistics of the collection the documents are scored against, see set_collection()
+	double num_docs = 0;
+	double avg_length = 1;
+
+public:
+
+	BM25(double k1 = DEFAULT_K1, double b = DEFAULT_B, double proximity_weight = DEFAULT_PROXIMITY_WEIGHT) {
+		this->k1 = k1;
+		this->b = b;
+		this->proximity_weight = proximity_weight;
+	}
+
+
+	// Sets the number of documents searched and their average length, before scoring a query
+	void set_collection(int num_docs, double avg_length) {
+		this->num_docs = num_docs;
+		this->avg_length = (avg_length > 0) ? avg_length : 1;
+	}
+
+
+	// The weight of a term that appeared in df documents. It never goes below 0, even for a term in more than half the documents
+	double idf(int df) const {
+		return max(0.0, log(1 + (num_docs - df + 0.5) / (df + 0.5)));
+	}
+
+
+	// The score of a document of length words in which a term of weight idf appeared tf times
+	double score(uint32_t tf, uint32_t length, double idf) const {
+		double norm = k1 * (1 - b + b * length / avg_length);
+		return idf * tf * (k1 + 1) / (tf + norm);
+	}
+
+
+	// The boost of a document where num_terms different search terms appeared, the shortest stretch of text that has all of
+	// them being span words long (see CoveringSpan.h). It is proximity_weight for each term after the first when they follow
+	// each other, and goes down as the other words between them add up
+	double proximity(uint32_t span, int num_terms) const {
+		if (num_terms < 2) {
+			return 0;
+		}
+		// The other words in the stretch. Two different terms are never at the same position, so span is at least num_terms
+		uint32_t gaps = (span > num_terms) ? span - num_terms : 0;
+		return proximity_weight * (num_terms - 1) / (1 + gaps);
+	}
+
+	// The largest boost of a document with at most num_terms different search terms
+	double max_proximity(int num_terms) const {
+		return proximity(num_terms, num_terms);
+	}
+
+	bool has_proximity() const {
+		return proximity_weight > 0;
+	}
+
+
+	double get_k1() const {
+		return k1;
+	}
+
+	double get_b() const {
+		return b;
+	}
+
+};
+
+
+#endif
@@ -0,0 +1,442 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+
+#include "SearchEngine.h"
+
+using namespace std;
+
+// The benchmarks time the faster code paths against the ones they replaced, on the same dataset the search engine indexes.
+// Every benchmark also checks that both paths produce the same result
+void benchmark_parse_json(vector<string>& file_paths);
+void benchmark_normalizer(vector<string>& file_paths);
+void benchmark_posting_decode(AVLTree& word_tree);
+void benchmark_or_queries(AVLTree& word_tree, DocumentTable& doc_table, BM25& bm25, const LiveDocs& live_docs);
+void benchmark_intersection(AVLTree& word_tree);
+
+using timer = chrono::high_resolution_clock;
+
+
+// Runs all the benchmarks, called from the menu. The posting list and query benchmarks use the lists of the index that was built,
+// the queries skip its deleted documents
+void run_benchmarks(AVLTree& word_tree, DocumentTable& doc_table, BM25& bm25, const LiveDocs& live_docs) {
+
+	vector<string> file_paths;
+	parse_directory("../dataset_small", file_paths);
+
+	if (file_paths.empty()) {
+		cout << "No json files to run the benchmarks on." << endl;
+		return;
+	}
+
+	benchmark_parse_json(file_paths);
+	benchmark_normalizer(file_paths);
+	benchmark_posting_decode(word_tree);
+	benchmark_or_queries(word_tree, doc_table, bm25, live_docs);
+	benchmark_intersection(word_tree);
+}
+
+
+// Returns the microseconds elapsed since start
+double elapsed_us(timer::time_point start) {
+	return chrono::duration_cast<chrono::nanoseconds>(timer::now() - start).count() / 1000.0;
+}
+
+
+// Per file parse time of the json tree parser (parse_json_dom) against the SAX extractor (parse_json)
+void benchmark_parse_json(vector<string>& file_paths) {
+
+	int repeats = 5;
+	double dom_us = 0, sax_us = 0;
+	bool same = true;
+
+	for (int r = 0; r < repeats; r += 1) {
+		for (int i = 0; i < file_paths.size(); i += 1) {
+
+			timer::time_point start = timer::now();
+			Article dom_article = parse_json_dom(file_paths.at(i));
+			dom_us += elapsed_us(start);
+
+			start = timer::now();
+			Article sax_article;
+			parse_json(file_paths.at(i), sax_article);
+			sax_us += elapsed_us(start);
+
+			if (dom_article.get_id() != sax_article.get_id() || dom_article.get_title() != sax_article.get_title() ||
+				dom_article.get_authors() != sax_article.get_authors() || dom_article.get_authors_last() != sax_article.get_authors_last() ||
+				dom_article.get_text_ref() != sax_article.get_text_ref()) {
+				same = false;
+			}
+		}
+	}
+
+	int num_parsed = repeats * file_paths.size();
+	cout << "parse_json (" << file_paths.size() << " files x " << repeats << ")" << endl;
+	cout << "  json tree:      " << dom_us / num_parsed << " us per file" << endl;
+	cout << "  SAX extractor:  " << sax_us / num_parsed << " us per file" << endl;
+	cout << "  speedup:        " << dom_us / sax_us << "x" << (same ? "" : "  (ARTICLES DIFFER)") << endl << endl;
+}
+
+
+
+// Time to turn the body texts into tokens with remove_punctuation(), to_lower() and tokenize() against the TextNormalizer,
+// with each of the kernels this CPU can run
+void benchmark_normalizer(vector<string>& file_paths) {
+
+	vector<string> texts;
+	long long num_bytes = 0;
+	for (int i = 0; i < file_paths.size(); i += 1) {
+		Article article;
+		parse_json(file_paths.at(i), article);
+		texts.push_back(article.get_text());
+		num_bytes += texts.back().size();
+	}
+
+	int repeats = 5;
+	double mb = repeats * num_bytes / (1024.0 * 1024.0);
+
+	// The tokens of the old chain, every kernel is checked against them
+	vector<vector<string>> chain_tokens(texts.size());
+	double chain_us = 0;
+	for (int r = 0; r < repeats; r += 1) {
+		for (int i = 0; i < texts.size(); i += 1) {
+			string text = texts.at(i);
+			timer::time_point start = timer::now();
+			remove_punctuation(text);
+			to_lower(text);
+			chain_tokens.at(i) = tokenize(text);
+			chain_us += elapsed_us(start);
+		}
+	}
+
+	cout << "text normalization (" << texts.size() << " body texts x " << repeats << ", " << num_bytes / 1024 << " KB)" << endl;
+	cout << "  remove_punctuation + to_lower + tokenize: " << chain_us / 1000 << " ms (" << mb / (chain_us / 1e6) << " MB/s)" << endl;
+
+	TextNormalizer normalizer;
+	string kernel_names[] = {"scalar", "SSE2", "AVX2"};
+
+	for (int k = TextNormalizer::SCALAR; k <= TextNormalizer::best_kernel(); k += 1) {
+		normalizer.set_kernel((TextNormalizer::Kernel) k);
+		double fused_us = 0;
+		bool same = true;
+
+		for (int r = 0; r < repeats; r += 1) {
+			for (int i = 0; i < texts.size(); i += 1) {
+				string text = texts.at(i);
+				timer::time_point start = timer::now();
+				vector<TokenView>& fused_tokens = normalizer.normalize(text);
+				fused_us += elapsed_us(start);
+
+				if (chain_tokens.at(i).size() != fused_tokens.size()) {
+					same = false;
+					continue;
+				}
+				for (int j = 0; j < fused_tokens.size(); j += 1) {
+					if (text.compare(fused_tokens.at(j).offset, fused_tokens.at(j).length, chain_tokens.at(i).at(j)) != 0) {
+						same = false;
+						break;
+					}
+				}
+			}
+		}
+
+		string label = "TextNormalizer (" + kernel_names[k] + "):";
+		label.resize(42, ' ');
+		cout << "  " << label << fused_us / 1000 << " ms (" << mb / (fused_us / 1e6) << " MB/s), " 
+			<< chain_us / fused_us << "x" << (same ? "" : "  (TOKENS DIFFER)") << endl;
+	}
+	cout << endl;
+}
+
+
+
+// Decoded document ids per second for each block codec, and each Stream VByte kernel this CPU can run, over the posting lists
+// of the index, so the lists have the lengths and the gaps of the dataset. Every codec is checked against the ids of the index
+void benchmark_posting_decode(AVLTree& word_tree) {
+
+	vector<Node*> words = word_tree.get_words();
+	if (words.empty()) {
+		cout << "The index is empty, no posting lists to decode." << endl << endl;
+		return;
+	}
+
+	vector<vector<DocId>> lists;
+	long long num_postings = 0;
+	int num_long = 0;
+	int picked[3] = {0, 0, 0};
+	for (int i = 0; i < words.size(); i += 1) {
+		// The words whose documents were all removed have no list
+		const PostingList* postings = word_tree.get_postings(words.at(i)->data);
+		if (postings == nullptr) {
+			continue;
+		}
+		lists.push_back(vector<DocId>());
+		word_tree.get_doc_ids(words.at(i)->data, lists.back());
+		num_postings += lists.back().size();
+		num_long += lists.back().size() > PostingList::BLOCK_SIZE;
+		picked[postings->get_codec()] += 1;
+	}
+	if (num_postings == 0) {
+		cout << "The index is empty, no posting lists to decode." << endl << endl;
+		return;
+	}
+
+	// Decode at least 20M ids per codec so the timings are stable
+	int repeats = max(5LL, 20000000 / num_postings);
+
+	cout << "posting list decoding (" << lists.size() << " lists, " << num_postings << " ids, " << num_long << " lists longer than " 
+		<< PostingList::BLOCK_SIZE << " ids, x " << repeats << ")" << endl;
+	cout << "  codecs picked by the index: " << picked[BlockCodec::VARINT] << " varint, " << picked[BlockCodec::STREAM_VBYTE] 
+		<< " Stream VByte, " << picked[BlockCodec::PFOR] << " PFOR" << endl;
+
+	string names[] = {"varint", "Stream VByte (scalar)", "Stream VByte (SSSE3)", "Stream VByte (AVX2)", "PFOR", "picked per list"};
+	BlockCodec::Codec codecs[] = {BlockCodec::VARINT, BlockCodec::STREAM_VBYTE, BlockCodec::STREAM_VBYTE, BlockCodec::STREAM_VBYTE, 
+		BlockCodec::PFOR, BlockCodec::VARINT};
+	BlockCodec::Kernel kernels[] = {BlockCodec::SCALAR, BlockCodec::SCALAR, BlockCodec::SSSE3, BlockCodec::AVX2, 
+		BlockCodec::SCALAR, BlockCodec::best_kernel()};
+
+	vector<DocId> decoded;
+	for (int c = 0; c < 6; c += 1) {
+		if (kernels[c] > BlockCodec::best_kernel()) {
+			continue;
+		}
+		BlockCodec::set_kernel(kernels[c]);
+
+		vector<PostingList> encoded(lists.size());
+		long long num_bytes = 0;
+		for (int i = 0; i < lists.size(); i += 1) {
+			if (c == 5) {
+				encoded.at(i).encode(lists.at(i));
+			}
+			else {
+				encoded.at(i).encode(lists.at(i), codecs[c]);
+			}
+			// Without the padding after the SIMD codecs, 16 bytes that would swamp the size of the short lists
+			num_bytes += encoded.at(i).num_bytes();
+			if (encoded.at(i).get_codec() != BlockCodec::VARINT) {
+				num_bytes -= BlockCodec::PADDING;
+			}
+		}
+
+		bool same = true;
+		for (int i = 0; i < encoded.size(); i += 1) {
+			decoded.clear();
+			encoded.at(i).decode(decoded);
+			if (decoded != lists.at(i)) {
+				same = false;
+			}
+		}
+
+		// Most lists are short, so the whole pass is timed instead of each list
+		timer::time_point start = timer::now();
+		for (int r = 0; r < repeats; r += 1) {
+			for (int i = 0; i < encoded.size(); i += 1) {
+				decoded.clear();
+				encoded.at(i).decode(decoded);
+			}
+		}
+		double decode_us = elapsed_us(start);
+
+		string label = names[c] + ":";
+		label.resize(24, ' ');
+		cout << "  " << label << repeats * num_postings / decode_us << "M ids/s, " << (double) num_bytes / num_postings 
+			<< " bytes per id" << (same ? "" : "  (IDS DIFFER)") << endl;
+	}
+	cout << endl;
+
+	BlockCodec::set_kernel(BlockCodec::best_kernel());
+}
+
+
+
+// Documents scored and time to find the top 15 of OR queries with Block-Max WAND against scoring every document that has one of
+// the terms, on queries made of frequent words (the worst case of an OR query) and of a frequent word with a rarer one. Both have
+// to find the same top 15. Block-Max WAND also runs without the proximity boost, for what the boost costs
+void benchmark_or_queries(AVLTree& word_tree, DocumentTable& doc_table, BM25& bm25, const LiveDocs& live_docs) {
+
+	// The words of the index from the most frequent one down
+	vector<Node*> words = word_tree.get_sorted_words();
+	vector<pair<int, string>> by_df;
+	for (int i = 0; i < words.size(); i += 1) {
+		const PostingList* postings = word_tree.get_postings(words.at(i)->data);
+		if (postings != nullptr && words.at(i)->data != "") {
+			by_df.push_back(make_pair(-postings->size(), words.at(i)->data));
+		}
+	}
+	if (by_df.size() < 3) {
+		cout << "The index is empty, no OR queries to run." << endl << endl;
+		return;
+	}
+	sort(by_df.begin(), by_df.end());
+
+	vector<vector<string>> queries;
+	int ranks[] = {10, 50, 200, 1000};
+	for (int i = 0; i < 10 && i < by_df.size(); i += 2) {
+		for (int r = 0; r < 4; r += 1) {
+			queries.push_back({by_df.at(i).second, by_df.at(ranks[r] % by_df.size()).second});
+		}
+	}
+	for (int i = 0; i + 2 < 12 && i + 2 < by_df.size(); i += 3) {
+		queries.push_back({by_df.at(i).second, by_df.at(i + 1).second, by_df.at(i + 2).second});
+	}
+
+	// The same statistics as rank_or_query(), which leaves the deleted documents out
+	int num_live = doc_table.size() - live_docs.get_num_deleted();
+	bm25.set_collection(num_live, doc_table.get_average_length());
+	BM25 without_proximity(bm25.get_k1(), bm25.get_b(), 0);
+	without_proximity.set_collection(num_live, doc_table.get_average_length());
+	int k = 15;
+	int repeats = 20;
+	long long scored[3] = {0, 0, 0};
+	double query_us[3] = {0, 0, 0};
+	bool same = true;
+
+	for (int q = 0; q < queries.size(); q += 1) {
+		vector<DocId> results[3];
+		// 0 is exhaustive, 1 is Block-Max WAND, 2 is Block-Max WAND without the proximity boost
+		for (int mode = 0; mode < 3; mode += 1) {
+			timer::time_point start = timer::now();
+			for (int r = 0; r < repeats; r += 1) {
+				DocFilter filter;
+				TopK top_k(k);
+				BlockMaxWand wand(mode == 2 ? without_proximity : bm25, doc_table);
+				for (int i = 0; i < queries.at(q).size(); i += 1) {
+					const PostingList* postings = word_tree.get_postings(queries.at(q).at(i));
+					wand.add_list(*postings, bm25.idf(postings->size()), &live_docs);
+				}
+				wand.search(top_k, filter, mode > 0);
+
+				if (r == 0) {
+					scored[mode] += wand.get_num_scored();
+					top_k.get_results(results[mode]);
+				}
+			}
+			query_us[mode] += elapsed_us(start) / repeats;
+		}
+		if (results[0] != results[1]) {
+			same = false;
+		}
+	}
+
+	cout << "OR queries, top " << k << " (" << queries.size() << " queries of 2 and 3 words x " << repeats << ")" << endl;
+	cout << "  exhaustive:        " << scored[0] << " documents scored, " << query_us[0] / queries.size() << " us per query" << endl;
+	cout << "  Block-Max WAND:    " << scored[1] << " documents scored, " << query_us[1] / queries.size() << " us per query" << endl;
+	cout << "  scored:            " << 100.0 * scored[1] / scored[0] << "% of the documents, " << query_us[0] / query_us[1] << "x faster" 
+		<< (same ? "" : "  (RESULTS DIFFER)") << endl;
+	cout << "  without proximity: " << scored[2] << " documents scored, " << query_us[2] / queries.size() << " us per query" << endl << endl;
+}
+
+
+
+// gallop() with the shorter list first, for the intersection benchmark
+int gallop_shorter_first(const DocId* a, int na, const DocId* b, int nb, DocId* out) {
+	return (na <= nb) ? Intersection::gallop(a, na, b, nb, out) : Intersection::gallop(b, nb, a, na, out);
+}
+
+
+// Time to intersect the posting lists of pairs of words of the index with each Intersection kernel, against set_intersection()
+// into a new vector (how the AND queries were intersected before). The pairs are frequent words with each other (lists of
+// similar sizes) and frequent words with rarer ones (skewed sizes). Every kernel is checked against set_intersection()
+void benchmark_intersection(AVLTree& word_tree) {
+
+	vector<Node*> words = word_tree.get_sorted_words();
+	vector<pair<int, string>> by_df;
+	for (int i = 0; i < words.size(); i += 1) {
+		const PostingList* postings = word_tree.get_postings(words.at(i)->data);
+		if (postings != nullptr && words.at(i)->data != "") {
+			by_df.push_back(make_pair(-postings->size(), words.at(i)->data));
+		}
+	}
+	if (by_df.size() < 2) {
+		cout << "The index is empty, no posting lists to intersect." << endl << endl;
+		return;
+	}
+	sort(by_df.begin(), by_df.end());
+
+	// The pairs of decoded lists, similar sizes first
+	vector<vector<DocId>> firsts, seconds;
+	vector<bool> skewed;
+	for (int i = 0; i + 1 < by_df.size() && i < 20; i += 1) {
+		firsts.push_back(vector<DocId>());
+		seconds.push_back(vector<DocId>());
+		word_tree.get_doc_ids(by_df.at(i).second, firsts.back());
+		word_tree.get_doc_ids(by_df.at(i + 1).second, seconds.back());
+		skewed.push_back(false);
+	}
+	int ranks[] = {100, 500, 2000, 10000};
+	for (int i = 0; i < 5 && i < by_df.size(); i += 1) {
+		for (int r = 0; r < 4; r += 1) {
+			firsts.push_back(vector<DocId>());
+			seconds.push_back(vector<DocId>());
+			word_tree.get_doc_ids(by_df.at(i).second, firsts.back());
+			word_tree.get_doc_ids(by_df.at(ranks[r] % by_df.size()).second, seconds.back());
+			skewed.push_back(true);
+		}
+	}
+
+	long long num_ids[2] = {0, 0};
+	for (int p = 0; p < firsts.size(); p += 1) {
+		num_ids[skewed.at(p)] += firsts.at(p).size() + seconds.at(p).size();
+	}
+	int repeats = max(5LL, 20000000 / (num_ids[0] + num_ids[1]));
+
+	cout << "posting list intersection (" << firsts.size() << " pairs of words, " << num_ids[0] << " ids in pairs of similar sizes, "
+		<< num_ids[1] << " in skewed pairs, x " << repeats << ")" << endl;
+
+	string names[] = {"set_intersection", "merge", "gallop", "SIMD (SSE2)", "SIMD (AVX2)", "picked per pair"};
+	Intersection::Kernel kernels[] = {Intersection::SCALAR, Intersection::SCALAR, Intersection::SCALAR, Intersection::SSE2, 
+		Intersection::AVX2, Intersection::best_kernel()};
+	// Every kernel is called through a pointer, so they all pay for the same call. Otherwise the compiler inlines some of them
+	// into the loop and not others, which on short lists changes the timings more than the kernels do
+	int (*functions[])(const DocId*, int, const DocId*, int, DocId*) = {nullptr, Intersection::merge, gallop_shorter_first, 
+		Intersection::simd, Intersection::simd, Intersection::intersect};
+
+	vector<DocId> out;
+	for (int m = 0; m < 6; m += 1) {
+		if (kernels[m] > Intersection::best_kernel()) {
+			continue;
+		}
+		Intersection::set_kernel(kernels[m]);
+
+		double pair_us[2] = {0, 0};
+		bool same = true;
+		for (int p = 0; p < firsts.size(); p += 1) {
+			vector<DocId>& a = firsts.at(p);
+			vector<DocId>& b = seconds.at(p);
+			vector<DocId> expected;
+			set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(expected));
+
+			timer::time_point start = timer::now();
+			for (int r = 0; r < repeats; r += 1) {
+				if (m == 0) {
+					vector<DocId> result;
+					set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(result));
+					out.swap(result);
+				}
+				else {
+					out.resize(min(a.size(), b.size()));
+					out.resize(functions[m](a.data(), a.size(), b.data(), b.size(), out.data()));
+				}
+			}
+			pair_us[skewed.at(p)] += elapsed_us(start);
+			if (out != expected) {
+				same = false;
+			}
+		}
+
+		string label = names[m] + ":";
+		label.resize(24, ' ');
+		cout << "  " << label << repeats * num_ids[0] / pair_us[0] << "M ids/s similar, " << repeats * num_ids[1] / pair_us[1] 
+			<< "M ids/s skewed" << (same ? "" : "  (RESULTS DIFFER)") << endl;
+	}
+	cout << endl;
+
+	Intersection::set_kernel(Intersection::best_kernel());
+}
+
+
+#endif
@@ -0,0 +1,390 @@
+#ifndef BLOCKCODEC_H
+#define BLOCKCODEC_H
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>       // SSSE3 and AVX2 intrinsics
+#endif
+
+#include "DocumentTable.h"
+
+using namespace std;
+
+
+// The BlockCodec encodes and decodes one block of a PostingList. The encoders take the gaps between the document ids of the
+// block, the decoders add the gaps back up from base (the last id before the block) and write the document ids.
+//  - VARINT:       7 bits per byte, the high bit says another byte follows. The smallest for short lists
+//  - STREAM_VBYTE: the length of every gap (1 to 4 bytes) is a 2 bit code, the codes of 4 gaps share one control byte and all
+//                  the control bytes come before the data bytes. A control byte is all it takes to find the 4 gaps, so they are
+//                  moved into place with one byte shuffle (16 bytes with SSSE3, 32 with AVX2) and added up with SIMD adds
+//  - PFOR:         every gap is packed in the same number of bits b, picked so the whole block is as small as possible. The
+//                  few gaps that don't fit in b bits are exceptions, their high bits are patched in after the unpacking
+// The decoders of STREAM_VBYTE and PFOR may read up to PADDING bytes past the end of a block, so the buffers they decode from
+// have to be padded.
+class BlockCodec {
+
+public:
+	enum Codec : unsigned char { VARINT, STREAM_VBYTE, PFOR };
+	enum Kernel { SCALAR, SSSE3, AVX2 };
+
+	static constexpr int PADDING = 16;
+
+private:
+
+	// For every control byte, the shuffle that moves its 4 gaps into 4 uint32 lanes, and the number of data bytes they take
+	struct ShuffleTable {
+		unsigned char masks[256][16];
+		unsigned char lengths[256];
+
+		ShuffleTable() {
+			for (int c = 0; c < 256; c += 1) {
+				int src = 0;
+				for (int lane = 0; lane < 4; lane += 1) {
+					int len = ((c >> (2 * lane)) & 3) + 1;
+					for (int k = 0; k < 4; k += 1) {
+						// 0x80 makes the shuffle write a zero byte
+						masks[c][4 * lane + k] = (k < len) ? src + k : 0x80;
+					}
+					src += len;
+				}
+				lengths[c] = src;
+			}
+		}
+	};
+
+	static const ShuffleTable& shuffle_table() {
+		static const ShuffleTable table;
+		return table;
+	}
+
+	static Kernel& active_kernel() {
+		static Kernel kernel = best_kernel();
+		return kernel;
+	}
+
+
+	static int byte_length(uint32_t value) {
+		return value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+	}
+
+	static int bit_length(uint32_t value) {
+		return value == 0 ? 0 : 32 - __builtin_clz(value);
+	}
+
+
+	// Decodes the gaps [i, n) of a block, data points to the bytes of gap i and doc is the id before it.
+	// The SIMD kernels call it for the last few gaps of a block
+	static void decode_stream_vbyte_scalar(const unsigned char* control, const unsigned char* data, int i, int n, DocId doc, DocId* out) {
+
+		for (; i < n; i += 1) {
+			int len = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+			// Read 4 bytes (the buffer is padded) and keep the len low ones, the gaps are little endian
+			uint32_t gap;
+			memcpy(&gap, data, 4);
+			gap &= 0xFFFFFFFFu >> (32 - 8 * len);
+			data += len;
+			doc += gap;
+			out[i] = doc;
+		}
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+	__attribute__((target("ssse3")))
+	static void decode_stream_vbyte_ssse3(const unsigned char* in, int n, DocId base, DocId* out) {
+
+		const ShuffleTable& table = shuffle_table();
+		const unsigned char* control = in;
+		const unsigned char* data = in + (n + 3) / 4;
+
+		__m128i prev = _mm_set1_epi32(base);
+		int i = 0;
+		for (; i + 4 <= n; i += 4) {
+			unsigned char c = control[i / 4];
+			__m128i gaps = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) data), _mm_loadu_si128((const __m128i*) table.masks[c]));
+			data += table.lengths[c];
+
+			// Prefix sum of the 4 lanes, then add the last id of the previous group
+			gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 4));
+			gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 8));
+			__m128i docs = _mm_add_epi32(gaps, prev);
+			_mm_storeu_si128((__m128i*) (out + i), docs);
+			prev = _mm_shuffle_epi32(docs, 0xFF);
+		}
+		decode_stream_vbyte_scalar(control, data, i, n, (i == 0) ? base : out[i - 1], out);
+	}
+
+	__attribute__((target("avx2")))
+	static void decode_stream_vbyte_avx2(const unsigned char* in, int n, DocId base, DocId* out) {
+
+		const ShuffleTable& table = shuffle_table();
+		const unsigned char* control = in;
+		const unsigned char* data = in + (n + 3) / 4;
+
+		__m256i prev = _mm256_set1_epi32(base);
+		__m256i low_lane_last = _mm256_setr_epi32(0, 0, 0, 0, 3, 3, 3, 3);
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			// Two control bytes, each one shuffles its own 128 bit lane
+			unsigned char c0 = control[i / 4];
+			unsigned char c1 = control[i / 4 + 1];
+			__m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) data)),
+				_mm_loadu_si128((const __m128i*) (data + table.lengths[c0])), 1);
+			__m256i masks = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) table.masks[c0])),
+				_mm_loadu_si128((const __m128i*) table.masks[c1]), 1);
+			__m256i gaps = _mm256_shuffle_epi8(bytes, masks);
+			data += table.lengths[c0] + table.lengths[c1];
+
+			// Prefix sum inside each lane, then carry the sum of the low lane into the high lane
+			gaps = _mm256_add_epi32(gaps, _mm256_slli_si256(gaps, 4));
+			gaps = _mm256_add_epi32(gaps, _mm256_slli_si256(gaps, 8));
+			__m256i carry = _mm256_blend_epi32(_mm256_setzero_si256(), _mm256_permutevar8x32_epi32(gaps, low_lane_last), 0xF0);
+			__m256i docs = _mm256_add_epi32(_mm256_add_epi32(gaps, carry), prev);
+			_mm256_storeu_si256((__m256i*) (out + i), docs);
+			prev = _mm256_permutevar8x32_epi32(docs, _mm256_set1_epi32(7));
+		}
+		decode_stream_vbyte_scalar(control, data, i, n, (i == 0) ? base : out[i - 1], out);
+	}
+
+#endif
+
+public:
+
+	// The widest kernel this CPU can run
+	static Kernel best_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+		if (__builtin_cpu_supports("avx2")) {
+			return AVX2;
+		}
+		if (__builtin_cpu_supports("ssse3")) {
+			return SSSE3;
+		}
+#endif
+		return SCALAR;
+	}
+
+	// Forces the kernel the STREAM_VBYTE blocks are decoded with, used by the benchmarks. A kernel the CPU can't run falls
+	// back to the best one it can
+	static void set_kernel(Kernel k) {
+		active_kernel() = (k > best_kernel()) ? best_kernel() : k;
+	}
+
+	static Kernel get_kernel() {
+		return active_kernel();
+	}
+
+
+	// VARINT
+
+	static void encode_varint(const uint32_t* gaps, int n, vector<unsigned char>& out) {
+		for (int i = 0; i < n; i += 1) {
+			uint32_t value = gaps[i];
+			while (value >= 0x80) {
+				out.push_back((value & 0x7F) | 0x80);
+				value >>= 7;
+			}
+			out.push_back(value);
+		}
+	}
+
+	static void decode_varint(const unsigned char* in, int n, DocId base, DocId* out) {
+		DocId doc = base;
+		for (int i = 0; i < n; i += 1) {
+			uint32_t value = *in & 0x7F;
+			int shift = 7;
+			while (*in & 0x80) {
+				in += 1;
+				value |= (uint32_t) (*in & 0x7F) << shift;
+				shift += 7;
+			}
+			in += 1;
+			doc += value;
+			out[i] = doc;
+		}
+	}
+
+
+	// STREAM_VBYTE
+
+	static void encode_stream_vbyte(const uint32_t* gaps, int n, vector<unsigned char>& out) {
+		int control = out.size();
+		out.resize(control + (n + 3) / 4, 0);
+		for (int i = 0; i < n; i += 1) {
+			int len = byte_length(gaps[i]);
+			out.at(control + i / 4) |= (len - 1) << (2 * (i % 4));
+			for (int k = 0; k < len; k += 1) {
+				out.push_back(gaps[i] >> (8 * k));
+			}
+		}
+	}
+
+	static void decode_stream_vbyte(const unsigned char* in, int n, DocId base, DocId* out) {
+#if defined(__x86_64__) || defined(__i386__)
+		if (active_kernel() == AVX2) {
+			decode_stream_vbyte_avx2(in, n, base, out);
+			return;
+		}
+		if (active_kernel() == SSSE3) {
+			decode_stream_vbyte_ssse3(in, n, base, out);
+			return;
+		}
+#endif
+		decode_stream_vbyte_scalar(in, in + (n + 3) / 4, 0, n, base, out);
+	}
+
+
+	// PFOR
+
+	// The b that makes the packed gaps and the exceptions as small as possible, and the number of bytes they take. Only the bit
+	// width of each gap matters: a gap of w > b bits is an exception, one byte for its position and a varint for its w - b high bits
+	static int pfor_width(const uint32_t* gaps, int n, int& size) {
+		int num_gaps[33] = {};
+		for (int i = 0; i < n; i += 1) {
+			num_gaps[bit_length(gaps[i])] += 1;
+		}
+
+		int best_b = 32;
+		size = 4 * n;
+		for (int b = 0; b < 32; b += 1) {
+			int b_size = (n * b + 7) / 8;
+			for (int w = b + 1; w <= 32; w += 1) {
+				b_size += num_gaps[w] * (1 + (w - b + 6) / 7);
+			}
+			if (b_size < size) {
+				size = b_size;
+				best_b = b;
+			}
+		}
+		return best_b;
+	}
+
+	// The layout of a block is: b, the number of exceptions, the n gaps packed in b bits each, then the position and the high
+	// bits (as a varint) of each exception
+	static void encode_pfor(const uint32_t* gaps, int n, vector<unsigned char>& out) {
+
+		int size;
+		int b = pfor_width(gaps, n, size);
+		uint32_t mask = (b == 32) ? 0xFFFFFFFF : (1u << b) - 1;
+
+		out.push_back(b);
+		int num_exceptions = out.size();
+		out.push_back(0);
+
+		// Pack the low b bits of every gap, the lowest bits first
+		uint64_t buffer = 0;
+		int buffered = 0;
+		for (int i = 0; i < n; i += 1) {
+			buffer |= (uint64_t) (gaps[i] & mask) << buffered;
+			buffered += b;
+			while (buffered >= 8) {
+				out.push_back(buffer);
+				buffer >>= 8;
+				buffered -= 8;
+			}
+		}
+		if (buffered > 0) {
+			out.push_back(buffer);
+		}
+
+		for (int i = 0; i < n; i += 1) {
+			if (b < 32 && (gaps[i] >> b) != 0) {
+				out.at(num_exceptions) += 1;
+				out.push_back(i);
+				uint32_t high = gaps[i] >> b;
+				encode_varint(&high, 1, out);
+			}
+		}
+	}
+
+	static void decode_pfor(const unsigned char* in, int n, DocId base, DocId* out) {
+
+		int b = in[0];
+		int num_exceptions = in[1];
+		const unsigned char* packed = in + 2;
+		uint32_t mask = (b == 32) ? 0xFFFFFFFF : (1u << b) - 1;
+
+		// Every gap is inside the 8 bytes starting at the byte of its first bit, since b + 7 <= 64
+		for (int i = 0; i < n; i += 1) {
+			int bit = i * b;
+			uint64_t word;
+			memcpy(&word, packed + bit / 8, 8);
+			out[i] = (word >> (bit % 8)) & mask;
+		}
+
+		const unsigned char* exceptions = packed + (n * b + 7) / 8;
+		for (int e = 0; e < num_exceptions; e += 1) {
+			int i = *exceptions;
+			exceptions += 1;
+			uint32_t high = *exceptions & 0x7F;
+			int shift = 7;
+			while (*exceptions & 0x80) {
+				exceptions += 1;
+				high |= (uint32_t) (*exceptions & 0x7F) << shift;
+				shift += 7;
+			}
+			exceptions += 1;
+			out[i] |= high << b;
+		}
+
+		DocId doc = base;
+		for (int i = 0; i < n; i += 1) {
+			doc += out[i];
+			out[i] = doc;
+		}
+	}
+
+
+	static void encode(Codec codec, const uint32_t* gaps, int n, vector<unsigned char>& out) {
+		if (codec == STREAM_VBYTE) {
+			encode_stream_vbyte(gaps, n, out);
+		}
+		else if (codec == PFOR) {
+			encode_pfor(gaps, n, out);
+		}
+		else {
+			encode_varint(gaps, n, out);
+		}
+	}
+
+	// The number of bytes encode writes for the n gaps, worked out from their bit widths without encoding them
+	static int encoded_size(Codec codec, const uint32_t* gaps, int n) {
+		int size = 0;
+		if (codec == STREAM_VBYTE) {
+			size = (n + 3) / 4;
+			for (int i = 0; i < n; i += 1) {
+				size += byte_length(gaps[i]);
+			}
+		}
+		else if (codec == PFOR) {
+			pfor_width(gaps, n, size);
+			size += 2;
+		}
+		else {
+			for (int i = 0; i < n; i += 1) {
+				size += max(1, (bit_length(gaps[i]) + 6) / 7);
+			}
+		}
+		return size;
+	}
+
+	static void decode(Codec codec, const unsigned char* in, int n, DocId base, DocId* out) {
+		if (codec == STREAM_VBYTE) {
+			decode_stream_vbyte(in, n, base, out);
+		}
+		else if (codec == PFOR) {
+			decode_pfor(in, n, base, out);
+		}
+		else {
+			decode_varint(in, n, base, out);
+		}
+	}
+
+};
+
+
+#endif
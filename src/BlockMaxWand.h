@@ -0,0 +1,234 @@
+#ifndef BLOCKMAXWAND_H
+#define BLOCKMAXWAND_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include "DocumentTable.h"
+#include "PostingList.h"
+#include "LiveDocs.h"
+#include "BM25.h"
+#include "TopK.h"
+#include "CoveringSpan.h"
+
+using namespace std;
+
+
+// The documents a query keeps out of its results (the ones of the NOT term) and the ones it is restricted to (the ones of the
+// AUTHOR), both sorted. The documents have to be checked in increasing order, so the filter only moves forward in both lists
+class DocFilter {
+
+private:
+	vector<DocId> exclusions;
+	// Empty if the query isn't restricted
+	vector<DocId> required;
+	int exclusions_pos = 0;
+	int required_pos = 0;
+
+public:
+
+	DocFilter() {
+
+	}
+
+	DocFilter(vector<DocId>& exclusions, vector<DocId>& required) {
+		this->exclusions = exclusions;
+		this->required = required;
+	}
+
+
+	bool accepts(DocId doc) {
+		while (exclusions_pos < exclusions.size() && exclusions.at(exclusions_pos) < doc) {
+			exclusions_pos += 1;
+		}
+		if (exclusions_pos < exclusions.size() && exclusions.at(exclusions_pos) == doc) {
+			return false;
+		}
+
+		if (required.empty()) {
+			return true;
+		}
+		while (required_pos < required.size() && required.at(required_pos) < doc) {
+			required_pos += 1;
+		}
+		return required_pos < required.size() && required.at(required_pos) == doc;
+	}
+
+};
+
+
+
+// BlockMaxWand finds the top k documents of an OR query without scoring every document that has one of its terms.
+// The posting lists are walked document at a time, each one by a cursor. The score a term can add to a document is bounded by
+// its BM25 score with the largest term frequency of the list and the shortest document length, and more tightly by the largest
+// term frequency of the block the document is in. Once the top k is full, a document has to score more than the worst one
+// kept (the threshold) to get in. The proximity boost of a document (see BM25::proximity()) is bounded by the largest boost for
+// the number of terms it can have, and is added to the bounds below:
+//  - the cursors are sorted by their current document, the pivot is the first document where the bounds of the cursors up to
+//    it add up to more than the threshold. The documents before it can't get in, so the cursors behind skip to it
+//  - if the bounds of the blocks the cursors have at the pivot don't add up to more than the threshold either, no document
+//    up to the end of the first of those blocks can get in, and the cursors skip past them without decoding the blocks
+//  - otherwise the pivot is scored
+// The lists of one call have to be in the same segment of the index, so a document is in at most one list of each term
+class BlockMaxWand {
+
+private:
+	struct Cursor {
+		PostingList::Iterator it;
+		double idf;
+		// The largest score the term can add to a document
+		double max_score;
+	};
+
+	vector<Cursor> cursors;
+	BM25& bm25;
+	DocumentTable& doc_table;
+	uint32_t min_length;
+	long long num_scored = 0;
+	// Reused for every scored document
+	vector<int> on_doc;
+	CoveringSpan span;
+	vector<const PostingList*> span_lists;
+
+
+	double upper_bound(const Cursor& cursor, uint32_t freq) {
+		return bm25.score(freq, min_length, cursor.idf);
+	}
+
+	DocId doc(int c) {
+		return cursors.at(c).it.doc();
+	}
+
+
+	// The score of a document, given the cursors that are on it: the BM25 scores of their terms, added up in the order of the
+	// query so the score doesn't depend on the order of the cursors, and the proximity boost of the different terms
+	double score(DocId doc, const vector<int>& on) {
+		double score = 0;
+		span.clear();
+		span_lists.clear();
+		for (int i = 0; i < on.size(); i += 1) {
+			Cursor& cursor = cursors.at(on.at(i));
+			score += bm25.score(cursor.it.freq(), doc_table.get_length(doc), cursor.idf);
+
+			// A term repeated in the query has the same list twice
+			const PostingList* list = &cursor.it.get_list();
+			if (bm25.has_proximity() && on.size() > 1 && list->has_positions() && find(span_lists.begin(), span_lists.end(), list) == span_lists.end()) {
+				span.add(cursor.it.positions(), cursor.it.freq());
+				span_lists.push_back(list);
+			}
+		}
+		return score + bm25.proximity(span.min_span(), span.num_terms());
+	}
+
+public:
+
+	BlockMaxWand(BM25& bm25, DocumentTable& doc_table) : bm25(bm25), doc_table(doc_table) {
+		this->min_length = doc_table.get_min_length();
+	}
+
+
+	// Adds the posting list of a term of weight idf to the query. The deleted documents are skipped
+	void add_list(const PostingList& list, double idf, const LiveDocs* live_docs) {
+		Cursor cursor{PostingList::Iterator(list, live_docs), idf, 0};
+		cursor.max_score = upper_bound(cursor, list.get_max_freq());
+		cursors.push_back(cursor);
+	}
+
+
+	// Collects the documents of the lists that the filter accepts into top_k. Without pruning, every one of them is scored
+	void search(TopK& top_k, DocFilter& filter, bool prune = true) {
+
+		// The cursors that aren't at the end, sorted by their current document
+		vector<int> order;
+		for (int c = 0; c < cursors.size(); c += 1) {
+			order.push_back(c);
+		}
+
+		while (true) {
+			order.erase(remove_if(order.begin(), order.end(), [this](int c) { return cursors.at(c).it.at_end(); }), order.end());
+			if (order.empty()) {
+				break;
+			}
+			sort(order.begin(), order.end(), [this](int a, int b) { return doc(a) < doc(b); });
+
+			// The scores are never negative, so until the top k is full every document gets in
+			double threshold = (prune && top_k.full()) ? top_k.min_score() : -1;
+
+			double bound = 0;
+			int pivot = -1;
+			for (int p = 0; p < order.size(); p += 1) {
+				bound += cursors.at(order.at(p)).max_score;
+				if (bound + bm25.max_proximity(p + 1) > threshold) {
+					pivot = p;
+					break;
+				}
+			}
+			// Even a document in every remaining list can't get in
+			if (pivot == -1) {
+				break;
+			}
+			DocId pivot_doc = doc(order.at(pivot));
+			while (pivot + 1 < order.size() && doc(order.at(pivot + 1)) == pivot_doc) {
+				pivot += 1;
+			}
+
+			// The bounds of the blocks the cursors up to the pivot have at the pivot document, and the end of the first of them
+			double block_bound = 0;
+			DocId blocks_end = numeric_limits<DocId>::max();
+			for (int p = 0; p <= pivot; p += 1) {
+				Cursor& cursor = cursors.at(order.at(p));
+				int b = cursor.it.find_block(pivot_doc);
+				if (b < cursor.it.get_list().num_blocks()) {
+					block_bound += upper_bound(cursor, cursor.it.get_list().block_max_freq(b));
+					blocks_end = min(blocks_end, cursor.it.get_list().block_last_doc(b));
+				}
+			}
+
+			if (block_bound + bm25.max_proximity(pivot + 1) > threshold) {
+				if (doc(order.at(0)) == pivot_doc) {
+					// Every cursor up to the pivot is on the pivot document
+					if (filter.accepts(pivot_doc)) {
+						on_doc.clear();
+						for (int c = 0; c < cursors.size(); c += 1) {
+							if (!cursors.at(c).it.at_end() && doc(c) == pivot_doc) {
+								on_doc.push_back(c);
+							}
+						}
+						top_k.push(pivot_doc, score(pivot_doc, on_doc));
+						num_scored += 1;
+					}
+					for (int p = 0; p <= pivot; p += 1) {
+						cursors.at(order.at(p)).it.next();
+					}
+				}
+				else {
+					for (int p = 0; p < pivot; p += 1) {
+						cursors.at(order.at(p)).it.advance(pivot_doc);
+					}
+				}
+			}
+			else {
+				// The next document that can get in is past the end of the blocks, and is at most the one of the next cursor
+				DocId target = (blocks_end == numeric_limits<DocId>::max()) ? blocks_end : blocks_end + 1;
+				if (pivot + 1 < order.size()) {
+					target = min(target, doc(order.at(pivot + 1)));
+				}
+				for (int p = 0; p <= pivot; p += 1) {
+					cursors.at(order.at(p)).it.advance(target);
+				}
+			}
+		}
+	}
+
+
+	// The number of documents scored by the searches
+	long long get_num_scored() {
+		return num_scored;
+	}
+
+};
+
+
+#endif
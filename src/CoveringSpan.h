@@ -0,0 +1,74 @@
+#ifndef COVERINGSPAN_H
+#define COVERINGSPAN_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+
+// CoveringSpan finds how close the search terms are in a document: given the sorted positions of each term, the minimal
+// covering span is the length of the shortest stretch of the text that has every term in it. The lists are walked together
+// like in a merge, the window goes from the smallest current position to the largest one, and the list with the smallest
+// position moves on, until one of them runs out. That is O(n * m) for n positions of m terms (m is the few terms of a query).
+// The positions are read from the posting lists, so the text of the document is never read
+class CoveringSpan {
+
+private:
+	vector<const uint32_t*> lists;
+	vector<int> counts;
+	vector<int> next;
+
+public:
+
+	// Forgets the positions of the last document
+	void clear() {
+		lists.clear();
+		counts.clear();
+	}
+
+	// Adds the count sorted positions of a term
+	void add(const uint32_t* positions, int count) {
+		lists.push_back(positions);
+		counts.push_back(count);
+	}
+
+	int num_terms() const {
+		return lists.size();
+	}
+
+
+	// The length of the shortest stretch that has every term, in words. 0 if there are no terms
+	uint32_t min_span() {
+
+		if (lists.empty()) {
+			return 0;
+		}
+
+		next.assign(lists.size(), 0);
+		uint32_t best = UINT32_MAX;
+		while (true) {
+			int lowest = 0;
+			uint32_t highest = 0;
+			for (int i = 0; i < lists.size(); i += 1) {
+				uint32_t position = lists.at(i)[next.at(i)];
+				if (position < lists.at(lowest)[next.at(lowest)]) {
+					lowest = i;
+				}
+				highest = max(highest, position);
+			}
+			best = min(best, highest - lists.at(lowest)[next.at(lowest)] + 1);
+
+			next.at(lowest) += 1;
+			if (next.at(lowest) == counts.at(lowest)) {
+				return best;
+			}
+		}
+	}
+
+};
+
+
+#endif
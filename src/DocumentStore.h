@@ -0,0 +1,258 @@
+#ifndef DOCUMENTSTORE_H
+#define DOCUMENTSTORE_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>             // for rename()
+#include <unistd.h>           // for truncate()
+
+#include "Article.h"
+
+using namespace std;
+
+
+// The DocumentStore keeps the indexed articles on disk instead of in memory: their metadata, their body texts and how many words
+// and stop words were counted in them for the statistics. Every article is appended to one file as a record, and the i-th article
+// added can be read back by its position i, which is the same as its position in the articles vector. The file is kept from one
+// run to the next, so the articles of an index that is opened again don't have to be parsed again.
+//
+// A record is: the paper id, the title, the number of authors and each author, the number of last names and each last name, the
+// number of words indexed and the number of stop words of the article (uint32 each), then the body text. Every string is its length
+// (uint32) followed by its characters
+class DocumentStore {
+
+private:
+	string file_path;
+	fstream store_fs;
+
+	// The byte offset of each record, and the byte offset and the length of its text, in the store file
+	vector<long long> offsets;
+	vector<long long> text_offsets;
+	vector<int> lengths;
+	vector<uint32_t> num_words;
+	vector<uint32_t> num_stop_words;
+
+
+	static void put_u32(string& out, uint32_t value) {
+		out.append((const char*) &value, 4);
+	}
+
+	static void put_string(string& out, const string& value) {
+		put_u32(out, value.size());
+		out += value;
+	}
+
+	bool get_u32(uint32_t& value) {
+		store_fs.read((char*) &value, 4);
+		return (bool) store_fs;
+	}
+
+	// A length past the end of the file is a record that was cut short
+	bool get_string(string& value, long long file_size) {
+		uint32_t length;
+		if (!get_u32(length) || (long long) store_fs.tellg() + length > file_size) {
+			return false;
+		}
+		value.resize(length);
+		store_fs.read(&value[0], length);
+		return (bool) store_fs;
+	}
+
+	bool get_strings(vector<string>& values, long long file_size) {
+		uint32_t count;
+		if (!get_u32(count)) {
+			return false;
+		}
+		values.clear();
+		for (uint32_t i = 0; i < count; i += 1) {
+			values.push_back(string());
+			if (!get_string(values.back(), file_size)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	// Reads the record at offset, without its text. Returns false if the file ends before the record does
+	bool read_record(long long offset, long long file_size, Article& article, uint32_t& words, uint32_t& stop_words, uint32_t& length) {
+		string id, title;
+		vector<string> authors, authors_last;
+		store_fs.clear();
+		store_fs.seekg(offset);
+		if (!get_string(id, file_size) || !get_string(title, file_size) || !get_strings(authors, file_size) ||
+			!get_strings(authors_last, file_size) || !get_u32(words) || !get_u32(stop_words) || !get_u32(length) ||
+			(long long) store_fs.tellg() + length > file_size) {
+			return false;
+		}
+		article = Article(id, title, authors, authors_last, "");
+		return true;
+	}
+
+
+	// Finds the records of the store file. A record cut short by a crash is dropped from the file
+	void scan() {
+		store_fs.seekg(0, ios::end);
+		long long file_size = store_fs.tellg();
+
+		long long offset = 0;
+		Article article;
+		uint32_t words, stop_words, length;
+		while (offset < file_size && read_record(offset, file_size, article, words, stop_words, length)) {
+			offsets.push_back(offset);
+			text_offsets.push_back(store_fs.tellg());
+			lengths.push_back(length);
+			num_words.push_back(words);
+			num_stop_words.push_back(stop_words);
+			offset = text_offsets.back() + length;
+		}
+		store_fs.clear();
+		if (offset < file_size) {
+			cut(offset);
+		}
+	}
+
+
+	// Cuts the store file to size bytes
+	void cut(long long size) {
+		store_fs.flush();
+		if (truncate(file_path.c_str(), size) != 0) {
+			cout << "Couldn't truncate the document store " << file_path << endl;
+		}
+		store_fs.clear();
+	}
+
+
+	void open() {
+		// Create the file if it isn't there yet, in | out doesn't
+		ofstream(file_path, ios::binary | ios::app).close();
+		store_fs.open(file_path, ios::in | ios::out | ios::binary);
+		if (!store_fs.is_open()) {
+			cout << "Couldn't open the document store " << file_path << endl;
+		}
+	}
+
+public:
+
+	// Opens the store file and finds the articles already in it
+	DocumentStore(string file_path) {
+		this->file_path = file_path;
+		open();
+		scan();
+	}
+
+	~DocumentStore() {
+		store_fs.close();
+	}
+
+
+	// Appends an article with its body text to the end of the store file and returns its position in the store. words and
+	// stop_words are the number of words indexed and the number of stop words of the article
+	int add(Article& article, uint32_t words, uint32_t stop_words) {
+		string record;
+		put_string(record, article.get_id());
+		put_string(record, article.get_title());
+		vector<string> authors = article.get_authors();
+		put_u32(record, authors.size());
+		for (int i = 0; i < authors.size(); i += 1) {
+			put_string(record, authors.at(i));
+		}
+		vector<string> authors_last = article.get_authors_last();
+		put_u32(record, authors_last.size());
+		for (int i = 0; i < authors_last.size(); i += 1) {
+			put_string(record, authors_last.at(i));
+		}
+		put_u32(record, words);
+		put_u32(record, stop_words);
+		put_u32(record, article.get_text_ref().size());
+
+		store_fs.seekp(0, ios::end);
+		offsets.push_back(store_fs.tellp());
+		text_offsets.push_back(offsets.back() + record.size());
+		lengths.push_back(article.get_text_ref().size());
+		num_words.push_back(words);
+		num_stop_words.push_back(stop_words);
+		store_fs.write(record.data(), record.size());
+		store_fs.write(article.get_text_ref().data(), article.get_text_ref().size());
+
+		return offsets.size() - 1;
+	}
+
+
+	// Reads the metadata of the article at position i back from the store file, without its body text
+	Article get_article(int i) {
+		Article article;
+		uint32_t words, stop_words, length;
+		store_fs.flush();
+		read_record(offsets.at(i), text_offsets.at(i) + lengths.at(i), article, words, stop_words, length);
+		return article;
+	}
+
+	// Reads the text at position i back from the store file
+	string get_text(int i) {
+		string text(lengths.at(i), ' ');
+
+		store_fs.flush();
+		store_fs.clear();
+		store_fs.seekg(text_offsets.at(i));
+		store_fs.read(&text[0], text.size());
+
+		return text;
+	}
+
+	uint32_t get_num_words(int i) {
+		return num_words.at(i);
+	}
+
+	uint32_t get_num_stop_words(int i) {
+		return num_stop_words.at(i);
+	}
+
+
+	int size() {
+		return offsets.size();
+	}
+
+
+	// Drops the articles from position n on, the file is cut after the last one that is kept
+	void resize(int n) {
+		if (n >= offsets.size()) {
+			return;
+		}
+		cut(offsets.at(n));
+		offsets.resize(n);
+		text_offsets.resize(n);
+		lengths.resize(n);
+		num_words.resize(n);
+		num_stop_words.resize(n);
+	}
+
+
+	void clear() {
+		cut(0);
+		offsets.clear();
+		text_offsets.clear();
+		lengths.clear();
+		num_words.clear();
+		num_stop_words.clear();
+	}
+
+
+	// Renames the store file to new_path and starts over with an empty store. The articles can still be read from new_path by
+	// opening another DocumentStore on it
+	void move_to(const string& new_path) {
+		store_fs.close();
+		if (rename(file_path.c_str(), new_path.c_str()) != 0) {
+			cout << "Couldn't rename the document store " << file_path << endl;
+		}
+		open();
+		clear();
+	}
+
+};
+
+
+#endif
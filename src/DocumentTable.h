@@ -0,0 +1,108 @@
+#ifndef DOCUMENTTABLE_H
+#define DOCUMENTTABLE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+
+// A document id is the position of an article in the order it was indexed, so it is also its position in the articles vector
+// and in the DocumentStore. The postings, the intersections and the ranking only work on document ids, the 40 character
+// paper_id is only looked up when it has to be shown or written to a file
+typedef uint32_t DocId;
+
+
+// The DocumentTable interns the paper_ids: the i-th paper_id added gets document id i, and can be found back from either side
+class DocumentTable {
+
+private:
+	vector<string> paper_ids;
+	// The number of words of each document, without the stop words, for ranking
+	vector<uint32_t> lengths;
+	long long total_length = 0;
+	// No document that has a word is shorter than this
+	uint32_t min_length = UINT32_MAX;
+	// If the same paper_id is indexed twice (e.g. a deleted paper added again), it maps to the last document with that paper_id
+	unordered_map<string, DocId> doc_ids;
+
+public:
+
+	DocumentTable() {
+
+	}
+
+
+	// Adds the paper_id of the next document, which has length words, and returns its document id
+	DocId add(const string& paper_id, uint32_t length = 0) {
+		DocId doc = paper_ids.size();
+		paper_ids.push_back(paper_id);
+		lengths.push_back(length);
+		total_length += length;
+		if (length > 0) {
+			min_length = min(min_length, length);
+		}
+		doc_ids[paper_id] = doc;
+		return doc;
+	}
+
+
+	string& get_paper_id(DocId doc) {
+		return paper_ids.at(doc);
+	}
+
+
+	uint32_t get_length(DocId doc) {
+		return lengths.at(doc);
+	}
+
+	void set_length(DocId doc, uint32_t length) {
+		total_length += (long long) length - lengths.at(doc);
+		lengths.at(doc) = length;
+		if (length > 0) {
+			min_length = min(min_length, length);
+		}
+	}
+
+	// A lower bound of the lengths of the documents that aren't empty
+	uint32_t get_min_length() {
+		return (min_length == UINT32_MAX) ? 1 : min_length;
+	}
+
+	double get_average_length() {
+		return paper_ids.empty() ? 0 : (double) total_length / paper_ids.size();
+	}
+
+
+	// Finds the document id of a paper_id, returns false if it hasn't been indexed
+	bool find(const string& paper_id, DocId& doc) {
+		auto it = doc_ids.find(paper_id);
+		if (it == doc_ids.end()) {
+			return false;
+		}
+		doc = it->second;
+		return true;
+	}
+
+
+	int size() {
+		return paper_ids.size();
+	}
+
+
+	void clear() {
+		paper_ids.clear();
+		lengths.clear();
+		total_length = 0;
+		min_length = UINT32_MAX;
+		doc_ids.clear();
+	}
+
+};
+
+
+#endif
@@ -6,6 +6,9 @@
 #include <string> 
 #include <functional>
 
+#include "DocumentTable.h"
+#include "LiveDocs.h"
+
 using namespace std;
 
 
@@ -15,7 +18,7 @@ private:
 
 	struct HashNode{
 		string author;
-		vector<string> id_list;
+		vector<DocId> id_list;
 
 		HashNode(string key) {
 			author = key;
@@ -45,28 +48,48 @@ public:
         return hash_value; 
     } 
   
-    void insert(string author, string paper_id) { 
+    void insert(string author, DocId doc) { 
     
         // inserting the element according to hash index 
     	int idx = get_hash_index(author);
   
     	// Find the bucket with same index (hash value), scan for the same key (author name)
-    	// if found, just push back the paper_id, if not found, create a new HashNode for the key (author name) and push back to the current bucket
+    	// if found, just push back the document id, if not found, create a new HashNode for the key (author name) and push back to the current bucket
         for (int i = 0; i < hash_table.at(idx).size(); i += 1) {
     
         	if (author == hash_table.at(idx).at(i).author) {
-        		hash_table.at(idx).at(i).id_list.push_back(paper_id);
+        		hash_table.at(idx).at(i).id_list.push_back(doc);
         		return;
         	}
         }
 
         HashNode n(author);
+        n.id_list.push_back(doc);
         hash_table.at(idx).push_back(n);
         num_unique_authors += 1;
     } 
 
 
-    vector<string> get_paper_ids(string author) {
+    // Appends a whole list of document ids to an author, for restoring the index
+    void insert(string author, vector<DocId>& doc_ids) {
+
+        int idx = get_hash_index(author);
+
+        for (int i = 0; i < hash_table.at(idx).size(); i += 1) {
+            if (author == hash_table.at(idx).at(i).author) {
+                hash_table.at(idx).at(i).id_list.insert(hash_table.at(idx).at(i).id_list.end(), doc_ids.begin(), doc_ids.end());
+                return;
+            }
+        }
+
+        HashNode n(author);
+        n.id_list = doc_ids;
+        hash_table.at(idx).push_back(n);
+        num_unique_authors += 1;
+    }
+
+
+    vector<DocId> get_doc_ids(string author) {
 
     	// Find the bucket with the same index (hash value)
         int idx = get_hash_index(author); 
@@ -78,11 +101,74 @@ public:
             }
         }
         cout << "author not found..." << endl;
-        vector<string> v;
+        vector<DocId> v;
         return v;
     }
   
 
+    // Appends the document ids of an author to doc_ids, returns false if the author isn't in the table
+    bool get_doc_ids(string author, vector<DocId>& doc_ids) {
+
+        int idx = get_hash_index(author);
+
+        for (int i = 0; i < hash_table.at(idx).size(); i += 1) { 
+            if (author == hash_table.at(idx).at(i).author) { 
+                doc_ids.insert(doc_ids.end(), hash_table.at(idx).at(i).id_list.begin(), hash_table.at(idx).at(i).id_list.end());
+                return true;
+            }
+        }
+        return false;
+    }
+  
+
+    // Merges a partial author index built from later articles into this table. Both tables have the same number of 
+    // buckets, so every author lands in the same bucket and keeps the order it was first seen in
+    void merge(HashTable& partial) {
+
+        for (int i = 0; i < partial.hash_table.size(); i += 1) {
+            for (int j = 0; j < partial.hash_table.at(i).size(); j += 1) {
+                HashNode& n = partial.hash_table.at(i).at(j);
+
+                if (partial.size != size) {
+                    for (int k = 0; k < n.id_list.size(); k += 1) {
+                        insert(n.author, n.id_list.at(k));
+                    }
+                    continue;
+                }
+
+                bool found = false;
+                for (int k = 0; k < hash_table.at(i).size(); k += 1) {
+                    if (n.author == hash_table.at(i).at(k).author) {
+                        hash_table.at(i).at(k).id_list.insert(hash_table.at(i).at(k).id_list.end(), n.id_list.begin(), n.id_list.end());
+                        found = true;
+                        break;
+                    }
+                }
+
+                if (!found) {
+                    hash_table.at(i).push_back(n);
+                    num_unique_authors += 1;
+                }
+            }
+        }
+    }
+
+
+    // Removes the deleted documents from the id lists, and the authors left without any
+    void remove_docs(const LiveDocs& live_docs) {
+        for (int i = 0; i < hash_table.size(); i += 1) {
+            for (int j = 0; j < hash_table.at(i).size(); j += 1) {
+                live_docs.remove_deleted(hash_table.at(i).at(j).id_list);
+                if (hash_table.at(i).at(j).id_list.empty()) {
+                    hash_table.at(i).erase(hash_table.at(i).begin() + j);
+                    num_unique_authors -= 1;
+                    j -= 1;
+                }
+            }
+        }
+    }
+
+
     void remove(string author) { 
 		// Find the bucket with the same index (hash value)
         int idx = get_hash_index(author); 
@@ -120,12 +206,27 @@ public:
         } 
     }
 
+    int get_size() {
+        return size;
+    }
+
+    // Copies out every author and its id_list, in the order of the buckets
+    void get_authors(vector<string>& authors, vector<vector<DocId>>& id_lists) {
+        for (int i = 0; i < hash_table.size(); i += 1) { 
+            for (int j = 0; j < hash_table.at(i).size(); j += 1) {
+                authors.push_back(hash_table.at(i).at(j).author);
+                id_lists.push_back(hash_table.at(i).at(j).id_list);
+            }
+        }
+    }
+
     int get_num_unique_authors() {
         return num_unique_authors;
     }
 
 
-    void write_to_file(ofstream& index_ofs) {
+    // The document ids are written as their paper ids
+    void write_to_file(ofstream& index_ofs, DocumentTable& doc_table) {
 
         for (int i = 0; i < hash_table.size(); i += 1) { 
             for (int j = 0; j < hash_table.at(i).size(); j += 1) {
@@ -133,7 +234,7 @@ public:
                 index_ofs << hash_table.at(i).at(j).author << endl;
                 /// write the id_list to the file right after author
                 for (int k = 0; k < hash_table.at(i).at(j).id_list.size(); k += 1) {
-                    index_ofs << hash_table.at(i).at(j).id_list.at(k) << endl;
+                    index_ofs << doc_table.get_paper_id(hash_table.at(i).at(j).id_list.at(k)) << endl;
                 }
             }
         }
@@ -0,0 +1,413 @@
+#ifndef INDEXFILE_H
+#define INDEXFILE_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>             // for rename()
+
+#include "AVLTree.h"
+#include "HashTable.h"
+#include "DocumentTable.h"
+#include "PostingList.h"
+#include "MappedFile.h"
+
+using namespace std;
+
+
+// The IndexFile is the binary index written once the index is built (index.bin), it replaces word_index.txt and author_index.txt.
+// The file is memory mapped when it is opened, so restoring the index doesn't read the file: the words are looked up in the
+// dictionary in place, and their posting lists are views on the mapped bytes, which the kernel only reads from the disk when a
+// query decodes them.
+//
+// Layout (all the integers are little endian):
+//  - header:     "CORDIDX\0", the format version (uint32), the number of sections (uint32), then the offset and the size
+//                (uint64 each) of every section
+//  - dictionary: the number of words (uint32), one ENTRY_SIZE entry per word sorted by word, then the characters of all the words.
+//                An entry is: the offset and the length of the word in the characters (uint32 each), the offset of its posting
+//                list in the postings section (uint64), the number of bytes, the number of ids, the last id, the offset of the
+//                term frequencies, the largest term frequency and the offset of the positions (0xFFFFFFFF if it has none) of the
+//                posting list (uint32 each), the codec of the posting list (uint8) and 3 bytes of padding
+//  - postings:   the encoded PostingLists back to back, in the same order as the dictionary
+//  - authors:    the number of authors (uint32), then for each author the length of its name (uint32), the name, the number of
+//                document ids (uint32) and the document ids (uint32 each)
+//  - documents:  the number of documents (uint32), then for each document id the length of its paper id (uint32), the paper id
+//                and the length of the document in words, without the stop words (uint32)
+class IndexFile {
+
+private:
+	enum Section { DICTIONARY, POSTINGS, AUTHORS, DOCUMENTS, NUM_SECTIONS };
+
+	static constexpr const char* MAGIC = "CORDIDX";     // with its '\0', 8 bytes
+	static constexpr uint32_t VERSION = 4;
+	static constexpr int HEADER_SIZE = 16 + NUM_SECTIONS * 16;
+	static constexpr int ENTRY_SIZE = 44;
+
+	MappedFile file;
+	bool opened = false;
+
+	const unsigned char* sections[NUM_SECTIONS];
+	uint64_t section_sizes[NUM_SECTIONS];
+
+	int num_words = 0;
+	const unsigned char* entries = nullptr;
+	const char* characters = nullptr;
+
+
+	static void put_u32(string& out, uint32_t value) {
+		out.append((const char*) &value, 4);
+	}
+
+	static void put_u64(string& out, uint64_t value) {
+		out.append((const char*) &value, 8);
+	}
+
+	static uint32_t get_u32(const unsigned char* in) {
+		uint32_t value;
+		memcpy(&value, in, 4);
+		return value;
+	}
+
+	static uint64_t get_u64(const unsigned char* in) {
+		uint64_t value;
+		memcpy(&value, in, 8);
+		return value;
+	}
+
+	const unsigned char* get_entry(int i) {
+		return entries + (size_t) i * ENTRY_SIZE;
+	}
+
+
+	bool fail(const string& file_path, const string& reason) {
+		cout << file_path << " " << reason << endl;
+		close();
+		return false;
+	}
+
+public:
+
+	IndexFile() {
+
+	}
+
+	// The posting lists restored from the file point into its mapping, so it can't be copied
+	IndexFile(const IndexFile&) = delete;
+	IndexFile& operator=(const IndexFile&) = delete;
+
+
+	// Writes the index to file_path. The file is written next to it first and renamed over it once it is complete, so a file that
+	// is still mapped by a restored index keeps its content
+	static bool write(const string& file_path, AVLTree& word_tree, HashTable& author_table, DocumentTable& doc_table) {
+
+		word_tree.seal();
+		vector<Node*> words = word_tree.get_sorted_words();
+
+		string dictionary, characters, postings;
+		uint32_t num_words = 0;
+		for (int i = 0; i < words.size(); i += 1) {
+			Node* curr = words.at(i);
+			// A word left without documents by removing deleted ones isn't written
+			if (curr->data == "" || curr->postings.size() == 0) {
+				continue;
+			}
+			num_words += 1;
+
+			put_u32(dictionary, characters.size());
+			put_u32(dictionary, curr->data.size());
+			put_u64(dictionary, postings.size());
+			put_u32(dictionary, curr->postings.num_bytes());
+			put_u32(dictionary, curr->postings.size());
+			put_u32(dictionary, curr->postings.get_last_doc());
+			put_u32(dictionary, curr->postings.get_freqs_offset());
+			put_u32(dictionary, curr->postings.get_max_freq());
+			put_u32(dictionary, curr->postings.get_positions_offset());
+			put_u32(dictionary, curr->postings.get_codec());     // the codec and 3 bytes of padding
+
+			characters += curr->data;
+			postings.append((const char*) curr->postings.data(), curr->postings.num_bytes());
+		}
+		string count;
+		put_u32(count, num_words);
+		dictionary = count + dictionary + characters;
+
+		vector<string> author_names;
+		vector<vector<DocId>> id_lists;
+		author_table.get_authors(author_names, id_lists);
+		string authors;
+		put_u32(authors, author_names.size());
+		for (int i = 0; i < author_names.size(); i += 1) {
+			put_u32(authors, author_names.at(i).size());
+			authors += author_names.at(i);
+			put_u32(authors, id_lists.at(i).size());
+			authors.append((const char*) id_lists.at(i).data(), id_lists.at(i).size() * sizeof(DocId));
+		}
+
+		string documents;
+		put_u32(documents, doc_table.size());
+		for (int i = 0; i < doc_table.size(); i += 1) {
+			put_u32(documents, doc_table.get_paper_id(i).size());
+			documents += doc_table.get_paper_id(i);
+			put_u32(documents, doc_table.get_length(i));
+		}
+
+		string* contents[NUM_SECTIONS] = {&dictionary, &postings, &authors, &documents};
+		string header(MAGIC, 8);
+		put_u32(header, VERSION);
+		put_u32(header, NUM_SECTIONS);
+		uint64_t offset = HEADER_SIZE;
+		for (int s = 0; s < NUM_SECTIONS; s += 1) {
+			put_u64(header, offset);
+			put_u64(header, contents[s]->size());
+			offset += contents[s]->size();
+		}
+
+		string temp_path = file_path + ".tmp";
+		ofstream index_ofs(temp_path, ios::binary | ios::trunc);
+		if (!index_ofs.is_open()) {
+			return false;
+		}
+		index_ofs.write(header.data(), header.size());
+		for (int s = 0; s < NUM_SECTIONS; s += 1) {
+			index_ofs.write(contents[s]->data(), contents[s]->size());
+		}
+		index_ofs.close();
+		if (!index_ofs) {
+			return false;
+		}
+
+		return rename(temp_path.c_str(), file_path.c_str()) == 0;
+	}
+
+
+	// Maps an index file and checks its header. Returns false if the file doesn't exist or isn't an index of this version
+	bool open(const string& file_path) {
+
+		close();
+		if (!file.open(file_path, false)) {
+			return false;
+		}
+
+		const unsigned char* header = (const unsigned char*) file.data();
+		if (file.size() < HEADER_SIZE || memcmp(header, MAGIC, 8) != 0) {
+			return fail(file_path, "is not an index file.");
+		}
+		if (get_u32(header + 8) != VERSION) {
+			return fail(file_path, "has version " + to_string(get_u32(header + 8)) + ", this program reads version " + to_string(VERSION) + ".");
+		}
+		if (get_u32(header + 12) != NUM_SECTIONS) {
+			return fail(file_path, "is corrupted.");
+		}
+
+		for (int s = 0; s < NUM_SECTIONS; s += 1) {
+			uint64_t offset = get_u64(header + 16 + s * 16);
+			section_sizes[s] = get_u64(header + 24 + s * 16);
+			if (offset > file.size() || section_sizes[s] > file.size() - offset) {
+				return fail(file_path, "is corrupted.");
+			}
+			sections[s] = header + offset;
+		}
+
+		if (section_sizes[DICTIONARY] < 4) {
+			return fail(file_path, "is corrupted.");
+		}
+		num_words = get_u32(sections[DICTIONARY]);
+		if ((section_sizes[DICTIONARY] - 4) / ENTRY_SIZE < num_words) {
+			return fail(file_path, "is corrupted.");
+		}
+		entries = sections[DICTIONARY] + 4;
+		characters = (const char*) get_entry(num_words);
+
+		opened = true;
+		return true;
+	}
+
+
+	void close() {
+		file.close();
+		opened = false;
+		num_words = 0;
+	}
+
+	bool is_open() {
+		return opened;
+	}
+
+
+	int get_num_words() {
+		return num_words;
+	}
+
+	string_view get_word(int i) {
+		const unsigned char* entry = get_entry(i);
+		return string_view(characters + get_u32(entry), get_u32(entry + 4));
+	}
+
+	// A view on the posting list of the i-th word, valid as long as the file is open
+	PostingList get_postings(int i) {
+		const unsigned char* entry = get_entry(i);
+		return PostingList(sections[POSTINGS] + get_u64(entry + 8), get_u32(entry + 16), get_u32(entry + 20), get_u32(entry + 24),
+			get_u32(entry + 28), get_u32(entry + 32), get_u32(entry + 36), (BlockCodec::Codec) entry[40]);
+	}
+
+	// Binary search of the dictionary, returns the position of the word or -1
+	int find(string_view word) {
+		int low = 0, high = num_words - 1;
+		while (low <= high) {
+			int mid = low + (high - low) / 2;
+			int cmp = get_word(mid).compare(word);
+			if (cmp == 0) {
+				return mid;
+			}
+			else if (cmp < 0) {
+				low = mid + 1;
+			}
+			else {
+				high = mid - 1;
+			}
+		}
+		return -1;
+	}
+
+
+	// The paper id of every document id of the file
+	vector<string> get_paper_ids() {
+		vector<uint32_t> lengths;
+		return get_paper_ids(lengths);
+	}
+
+	// The paper id of every document id of the file, and the length of every document in lengths
+	vector<string> get_paper_ids(vector<uint32_t>& lengths) {
+		vector<string> paper_ids;
+		const unsigned char* in = sections[DOCUMENTS];
+		uint32_t num_docs = get_u32(in);
+		in += 4;
+		for (uint32_t i = 0; i < num_docs; i += 1) {
+			uint32_t length = get_u32(in);
+			paper_ids.push_back(string((const char*) in + 4, length));
+			lengths.push_back(get_u32(in + 4 + length));
+			in += 8 + length;
+		}
+		return paper_ids;
+	}
+
+
+	// Restores the word index and the author index from the file into the (cleared) AVLTree and HashTable.
+	// If the articles were indexed in the same order as when the file was written, the document ids of the file are the ones of
+	// doc_table and the words get views on the mapped posting lists. Otherwise every id is mapped through its paper id, and
+	// the ids of the articles that aren't indexed are dropped. The lengths of the documents are restored into doc_table for ranking
+	void load(AVLTree& word_tree, HashTable& author_table, DocumentTable& doc_table) {
+
+		vector<uint32_t> lengths;
+		vector<string> paper_ids = get_paper_ids(lengths);
+		// The ids of the file can be used as they are if the documents it knows have the same ids in the table, which can know more
+		bool same_ids = (paper_ids.size() <= doc_table.size());
+		vector<DocId> doc_ids(paper_ids.size());
+		vector<bool> indexed(paper_ids.size());
+		for (int i = 0; i < paper_ids.size(); i += 1) {
+			indexed.at(i) = doc_table.find(paper_ids.at(i), doc_ids.at(i));
+			same_ids = same_ids && doc_table.get_paper_id(i) == paper_ids.at(i);
+			if (indexed.at(i)) {
+				doc_table.set_length(doc_ids.at(i), lengths.at(i));
+			}
+		}
+
+		// The dictionary is sorted, so the tree is built balanced in one go
+		vector<string> words;
+		vector<PostingList> postings;
+		vector<DocId> file_ids, mapped_ids;
+		vector<uint32_t> file_freqs, file_positions;
+		for (int i = 0; i < num_words; i += 1) {
+
+			if (same_ids) {
+				words.push_back(string(get_word(i)));
+				postings.push_back(get_postings(i));
+				continue;
+			}
+
+			file_ids.clear();
+			file_freqs.clear();
+			file_positions.clear();
+			get_postings(i).decode(file_ids, file_freqs, file_positions);
+
+			// Map the ids, dropping the ones that aren't indexed with their frequencies and positions
+			mapped_ids.clear();
+			int kept = 0;
+			size_t position = 0, kept_position = 0;
+			for (int j = 0; j < file_ids.size(); j += 1) {
+				uint32_t freq = file_freqs.at(j);
+				bool keep = file_ids.at(j) < indexed.size() && indexed.at(file_ids.at(j));
+				if (keep) {
+					mapped_ids.push_back(doc_ids.at(file_ids.at(j)));
+					file_freqs.at(kept) = freq;
+					kept += 1;
+				}
+				for (uint32_t p = 0; p < freq && !file_positions.empty(); p += 1) {
+					if (keep) {
+						file_positions.at(kept_position) = file_positions.at(position);
+						kept_position += 1;
+					}
+					position += 1;
+				}
+			}
+			file_freqs.resize(kept);
+			file_positions.resize(kept_position);
+
+			if (!mapped_ids.empty()) {
+				if (!is_sorted(mapped_ids.begin(), mapped_ids.end())) {
+					AVLTree::sort_postings(mapped_ids, file_freqs, file_positions);
+				}
+				words.push_back(string(get_word(i)));
+				postings.push_back(PostingList(mapped_ids, file_freqs, file_positions));
+			}
+		}
+		word_tree.build(words, postings);
+
+		const unsigned char* in = sections[AUTHORS];
+		uint32_t num_authors = get_u32(in);
+		in += 4;
+		for (uint32_t i = 0; i < num_authors; i += 1) {
+			uint32_t length = get_u32(in);
+			string author((const char*) in + 4, length);
+			in += 4 + length;
+
+			uint32_t num_ids = get_u32(in);
+			in += 4;
+			mapped_ids.clear();
+			for (uint32_t j = 0; j < num_ids; j += 1) {
+				DocId doc = get_u32(in + 4 * j);
+				if (doc < indexed.size() && indexed.at(doc)) {
+					mapped_ids.push_back(doc_ids.at(doc));
+				}
+			}
+			if (!mapped_ids.empty()) {
+				author_table.insert(author, mapped_ids);
+			}
+			in += 4 * num_ids;
+		}
+	}
+
+
+	// Writes the word index in the same layout as word_index.txt: every word followed by the paper ids it appeared in
+	void dump(ostream& os) {
+		vector<string> paper_ids = get_paper_ids();
+		vector<DocId> doc_ids;
+		for (int i = 0; i < num_words; i += 1) {
+			os << get_word(i) << "\n";
+			doc_ids.clear();
+			get_postings(i).decode(doc_ids);
+			for (int j = 0; j < doc_ids.size(); j += 1) {
+				os << paper_ids.at(doc_ids.at(j)) << "\n";
+			}
+		}
+	}
+
+};
+
+
+#endif
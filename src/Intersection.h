@@ -0,0 +1,229 @@
+#ifndef INTERSECTION_H
+#define INTERSECTION_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>       // SSE2 and AVX2 intrinsics
+#endif
+
+#include "DocumentTable.h"
+
+using namespace std;
+
+
+// The Intersection kernels intersect two sorted lists of document ids (without duplicates), the matches are written to out in
+// increasing order and their number is returned. out has room for the smaller list, and can be one of the two lists: a match is
+// never written past the ids of either list that were already read.
+//  - merge:     walks both lists like a merge, O(n + m)
+//  - gallop:    looks up every id of the small list in the large one by doubling the step from the last match, then a binary
+//               search, O(n log(m / n)). The fastest when one list is much longer than the other
+//  - SIMD:      compares a block of 4 (SSE2) or 8 (AVX2) ids of each list all against all, by comparing one block with every
+//               rotation of the other, and moves on in the list whose block ends first. The fastest for lists of similar sizes
+// intersect() picks one from the ratio of the list sizes. The AVX2 blocks only pay off for lists of about the same size, once
+// the lists are skewed most blocks of the long list have no match and the 8 rotations of a block cost more than they save
+class Intersection {
+
+public:
+	enum Kernel { SCALAR, SSE2, AVX2 };
+
+	// From this ratio of the list sizes on, galloping beats the SSE2 blocks
+	static const int GALLOP_RATIO = 64;
+	// Below this ratio the AVX2 blocks beat the SSE2 ones
+	static const int WIDE_RATIO = 4;
+	// A list shorter than this is merged, it hardly fills a block
+	static const int MIN_SIMD_SIZE = 16;
+
+private:
+
+	static Kernel& active_kernel() {
+		static Kernel kernel = best_kernel();
+		return kernel;
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+	__attribute__((target("sse2")))
+	static int simd_sse2(const DocId* a, int na, const DocId* b, int nb, DocId* out) {
+		int i = 0, j = 0, k = 0;
+		while (i + 4 <= na && j + 4 <= nb) {
+			__m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+			__m128i vb = _mm_loadu_si128((const __m128i*) (b + j));
+			__m128i eq = _mm_cmpeq_epi32(va, vb);
+			eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+			eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+			eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+
+			// One bit per id of the block of a that is in the block of b
+			int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+			DocId a_last = a[i + 3], b_last = b[j + 3];
+			while (mask != 0) {
+				out[k] = a[i + __builtin_ctz(mask)];
+				k += 1;
+				mask &= mask - 1;
+			}
+			i += (a_last <= b_last) ? 4 : 0;
+			j += (b_last <= a_last) ? 4 : 0;
+		}
+		return k + merge(a + i, na - i, b + j, nb - j, out + k);
+	}
+
+	__attribute__((target("avx2")))
+	static int simd_avx2(const DocId* a, int na, const DocId* b, int nb, DocId* out) {
+		__m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+		int i = 0, j = 0, k = 0;
+		while (i + 8 <= na && j + 8 <= nb) {
+			__m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+			__m256i vb = _mm256_loadu_si256((const __m256i*) (b + j));
+			__m256i eq = _mm256_cmpeq_epi32(va, vb);
+			for (int r = 1; r < 8; r += 1) {
+				vb = _mm256_permutevar8x32_epi32(vb, rotate);
+				eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(va, vb));
+			}
+
+			int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+			DocId a_last = a[i + 7], b_last = b[j + 7];
+			while (mask != 0) {
+				out[k] = a[i + __builtin_ctz(mask)];
+				k += 1;
+				mask &= mask - 1;
+			}
+			i += (a_last <= b_last) ? 8 : 0;
+			j += (b_last <= a_last) ? 8 : 0;
+		}
+		return k + merge(a + i, na - i, b + j, nb - j, out + k);
+	}
+
+#endif
+
+	// intersect() for lists that aren't both short, the shorter list goes first. Kept out of intersect(), inlined it makes
+	// every call save the registers it needs
+	__attribute__((noinline))
+	static int intersect_long(const DocId* a, int na, const DocId* b, int nb, DocId* out) {
+		if (na > nb) {
+			swap(a, b);
+			swap(na, nb);
+		}
+		if (na == 0) {
+			return 0;
+		}
+		if ((long long) na * GALLOP_RATIO <= nb) {
+			return gallop(a, na, b, nb, out);
+		}
+		if (na < MIN_SIMD_SIZE) {
+			return merge(a, na, b, nb, out);
+		}
+#if defined(__x86_64__) || defined(__i386__)
+		if (active_kernel() == AVX2 && (long long) na * WIDE_RATIO > nb) {
+			return simd_avx2(a, na, b, nb, out);
+		}
+		if (active_kernel() >= SSE2) {
+			return simd_sse2(a, na, b, nb, out);
+		}
+#endif
+		return merge(a, na, b, nb, out);
+	}
+
+public:
+
+	// The widest kernel this CPU can run
+	static Kernel best_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+		if (__builtin_cpu_supports("avx2")) {
+			return AVX2;
+		}
+		if (__builtin_cpu_supports("sse2")) {
+			return SSE2;
+		}
+#endif
+		return SCALAR;
+	}
+
+	// Forces the kernel simd() runs, used by the benchmarks. A kernel the CPU can't run falls back to the best one it can
+	static void set_kernel(Kernel k) {
+		active_kernel() = (k > best_kernel()) ? best_kernel() : k;
+	}
+
+	static Kernel get_kernel() {
+		return active_kernel();
+	}
+
+
+	static int merge(const DocId* a, int na, const DocId* b, int nb, DocId* out) {
+		int i = 0, j = 0, k = 0;
+		while (i < na && j < nb) {
+			if (a[i] < b[j]) {
+				i += 1;
+			}
+			else if (b[j] < a[i]) {
+				j += 1;
+			}
+			else {
+				out[k] = a[i];
+				k += 1;
+				i += 1;
+				j += 1;
+			}
+		}
+		return k;
+	}
+
+	// small should be the shorter list
+	static int gallop(const DocId* small, int ns, const DocId* large, int nl, DocId* out) {
+		int k = 0;
+		int from = 0;
+		for (int i = 0; i < ns && from < nl; i += 1) {
+			DocId target = small[i];
+			int step = 1;
+			int end = from;
+			while (end < nl && large[end] < target) {
+				from = end + 1;
+				end += step;
+				step *= 2;
+			}
+			from = lower_bound(large + from, large + min(end, nl), target) - large;
+			if (from < nl && large[from] == target) {
+				out[k] = target;
+				k += 1;
+				from += 1;
+			}
+		}
+		return k;
+	}
+
+	// The block compare with the active kernel, merge() without SIMD
+	static int simd(const DocId* a, int na, const DocId* b, int nb, DocId* out) {
+#if defined(__x86_64__) || defined(__i386__)
+		if (active_kernel() == AVX2) {
+			return simd_avx2(a, na, b, nb, out);
+		}
+		if (active_kernel() == SSE2) {
+			return simd_sse2(a, na, b, nb, out);
+		}
+#endif
+		return merge(a, na, b, nb, out);
+	}
+
+
+	// Picks the kernel from the sizes of the lists
+	static int intersect(const DocId* a, int na, const DocId* b, int nb, DocId* out) {
+		// Most lists of a small index are this short. Merging them right here keeps intersect() small enough to be inlined,
+		// a call costs about as much as merging them
+		if (na < MIN_SIMD_SIZE && nb < MIN_SIMD_SIZE) {
+			return merge(a, na, b, nb, out);
+		}
+		return intersect_long(a, na, b, nb, out);
+	}
+
+	// Keeps the ids of candidates that are also in list
+	static void intersect(vector<DocId>& candidates, const vector<DocId>& list) {
+		candidates.resize(intersect(candidates.data(), candidates.size(), list.data(), list.size(), candidates.data()));
+	}
+
+};
+
+
+#endif
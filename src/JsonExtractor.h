@@ -0,0 +1,192 @@
+#ifndef JSONEXTRACTOR_H
+#define JSONEXTRACTOR_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+
+#include "Article.h"
+#include "../utils/json.hpp"
+
+using namespace std;
+using json = nlohmann::json;
+
+
+// The JsonExtractor is a SAX handler for json.hpp's sax_parse. Instead of building the whole json tree of an article
+// (bib_entries, ref_entries, cite_spans, back_matter...), it only copies paper_id, metadata.title, metadata.authors and
+// body_text[].text into its own buffers as the parser walks over the file. The buffers are reused from one file to the next,
+// so after the first few files they no longer have to grow.
+class JsonExtractor : public nlohmann::json_sax<json> {
+
+private:
+	// The keys we care about, every other key is OTHER
+	enum Key { OTHER, PAPER_ID, METADATA, TITLE, AUTHORS, FIRST, LAST, BODY_TEXT, TEXT };
+
+	// keys.at(d) is the last key read in the object at nesting depth d (the root object is depth 1)
+	vector<Key> keys;
+	int depth = 0;
+
+	std::string paper_id;
+	std::string title;
+	std::string first_name;
+	std::string last_name;
+	vector<std::string> authors;
+	vector<std::string> authors_last;
+	int num_authors = 0;
+	std::string body_text;
+
+
+	Key to_key(std::string& val) {
+		if (depth == 1) {
+			if (val == "paper_id") return PAPER_ID;
+			if (val == "metadata") return METADATA;
+			if (val == "body_text") return BODY_TEXT;
+		}
+		else if (depth == 2 && keys.at(1) == METADATA) {
+			if (val == "title") return TITLE;
+			if (val == "authors") return AUTHORS;
+		}
+		else if (depth == 4 && in_author()) {
+			if (val == "first") return FIRST;
+			if (val == "last") return LAST;
+		}
+		else if (depth == 3 && keys.at(1) == BODY_TEXT) {
+			if (val == "text") return TEXT;
+		}
+		return OTHER;
+	}
+
+	// True while the parser is inside one of the objects of metadata.authors
+	bool in_author() {
+		return depth == 4 && keys.at(1) == METADATA && keys.at(2) == AUTHORS;
+	}
+
+	bool enter() {
+		depth += 1;
+		if (depth >= keys.size()) {
+			keys.resize(depth + 1, OTHER);
+		}
+		keys.at(depth) = OTHER;
+		return true;
+	}
+
+	bool leave() {
+		depth -= 1;
+		return true;
+	}
+
+public:
+
+	JsonExtractor() {
+		keys.resize(8, OTHER);
+		// Most body texts fit in this, bigger ones grow the buffer once and keep it for the next files
+		body_text.reserve(1 << 16);
+	}
+
+
+	// Extracts one article from the json text read from the stream. Returns false if the json is malformed
+	bool extract(istream& json_is) {
+		reset();
+		return json::sax_parse(json_is, this);
+	}
+
+	// Extracts one article from the json text in [first, last)
+	bool extract(const char* first, const char* last) {
+		reset();
+		return json::sax_parse(first, last, this);
+	}
+
+	void reset() {
+		depth = 0;
+		paper_id.clear();
+		title.clear();
+		num_authors = 0;
+		body_text.clear();
+	}
+
+
+	// Builds an Article out of the extracted fields, the same way parse_json did from the json tree
+	Article get_article() {
+		vector<std::string> article_authors(authors.begin(), authors.begin() + num_authors);
+		vector<std::string> article_authors_last(authors_last.begin(), authors_last.begin() + num_authors);
+
+		if (num_authors == 0) {
+			article_authors.push_back("N/A");
+			article_authors_last.push_back("N/A");
+		}
+
+		return Article(paper_id, title == "" ? "N/A" : title, article_authors, article_authors_last, body_text);
+	}
+
+
+	// The SAX events, every value outside of the fields we extract is skipped without being stored
+
+	bool null() override { return true; }
+	bool boolean(bool) override { return true; }
+	bool number_integer(number_integer_t) override { return true; }
+	bool number_unsigned(number_unsigned_t) override { return true; }
+	bool number_float(number_float_t, const string_t&) override { return true; }
+	bool binary(binary_t&) override { return true; }
+
+	bool string(string_t& val) override {
+		Key key = keys.at(depth);
+
+		if (depth == 1 && key == PAPER_ID) {
+			paper_id = val;
+		}
+		else if (depth == 2 && key == TITLE && keys.at(1) == METADATA) {
+			title = val;
+		}
+		else if (key == FIRST && in_author()) {
+			first_name = val;
+		}
+		else if (key == LAST && in_author()) {
+			last_name = val;
+		}
+		else if (depth == 3 && key == TEXT && keys.at(1) == BODY_TEXT) {
+			body_text += val;
+			body_text += " ";   // put a space between two strings when concatenating
+		}
+		return true;
+	}
+
+	bool start_object(size_t) override {
+		enter();
+		if (in_author()) {
+			first_name.clear();
+			last_name.clear();
+		}
+		return true;
+	}
+
+	bool end_object() override {
+		if (in_author()) {
+			if (num_authors == authors.size()) {
+				authors.push_back("");
+				authors_last.push_back("");
+			}
+			authors.at(num_authors) = first_name + " " + last_name;
+			authors_last.at(num_authors) = last_name;
+			num_authors += 1;
+		}
+		return leave();
+	}
+
+	bool start_array(size_t) override { return enter(); }
+	bool end_array() override { return leave(); }
+
+	bool key(string_t& val) override {
+		keys.at(depth) = to_key(val);
+		return true;
+	}
+
+	bool parse_error(size_t position, const std::string&, const nlohmann::detail::exception& ex) override {
+		cout << "couldn't parse the .json file at byte " << position << ": " << ex.what() << endl;
+		return false;
+	}
+
+};
+
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef LIVEDOCS_H
+#define LIVEDOCS_H
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+#include "DocumentTable.h"
+
+using namespace std;
+
+
+// LiveDocs is a bitset over the document ids marking the documents that were deleted (retracted or replaced papers).
+// Deleting a document only sets its bit, the posting lists that hold it are left as they are and skip it when they are read
+// (see PostingList::Iterator). The document is only removed from the postings when its segment is merged or the index is
+// compacted. Documents added after the last deletion are past the end of the bitset, and are live
+class LiveDocs {
+
+private:
+	vector<uint64_t> deleted_bits;
+	int num_deleted = 0;
+
+public:
+
+	LiveDocs() {
+
+	}
+
+
+	bool is_live(DocId doc) const {
+		size_t word = doc / 64;
+		return word >= deleted_bits.size() || (deleted_bits[word] & (uint64_t(1) << (doc % 64))) == 0;
+	}
+
+
+	// Marks a document as deleted, returns false if it already was
+	bool remove(DocId doc) {
+		if (!is_live(doc)) {
+			return false;
+		}
+		if (doc / 64 >= deleted_bits.size()) {
+			deleted_bits.resize(doc / 64 + 1, 0);
+		}
+		deleted_bits[doc / 64] |= uint64_t(1) << (doc % 64);
+		num_deleted += 1;
+		return true;
+	}
+
+
+	// Whether a document in [begin, end) was deleted
+	bool any_deleted(DocId begin, DocId end) const {
+		for (DocId doc = begin; doc < end && doc / 64 < deleted_bits.size(); doc += 1) {
+			if (!is_live(doc)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	// Removes the deleted documents from doc_ids, from position begin on
+	void remove_deleted(vector<DocId>& doc_ids, int begin = 0) const {
+		if (num_deleted == 0) {
+			return;
+		}
+		int kept = begin;
+		for (int i = begin; i < doc_ids.size(); i += 1) {
+			if (is_live(doc_ids[i])) {
+				doc_ids[kept] = doc_ids[i];
+				kept += 1;
+			}
+		}
+		doc_ids.resize(kept);
+	}
+
+
+	int get_num_deleted() const {
+		return num_deleted;
+	}
+
+
+	void clear() {
+		deleted_bits.clear();
+		num_deleted = 0;
+	}
+
+};
+
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <iostream>
+#include <streambuf>
+#include <vector>
+#include <string>
+
+#include <fcntl.h>			  // for open()
+#include <unistd.h>			  // for read() and close()
+#include <sys/mman.h>		  // for mmap(), madvise() and munmap()
+#include <sys/stat.h>		  // for fstat()
+
+using namespace std;
+
+
+// A MappedFile gives the whole content of a file as one contiguous range of bytes [data(), data() + size()).
+// Big files are memory mapped. By default they are read sequentially, so the kernel is told to read ahead and drop the pages 
+// behind us, files opened for random access (the index file) are only paged in where they are read.
+// Small files are cheaper to read() into a buffer than to map, so they are read instead, and so is any file mmap fails on.
+class MappedFile {
+
+private:
+	const char* bytes = nullptr;
+	size_t num_bytes = 0;
+	bool mapped = false;
+	bool opened = false;
+
+	// Holds the content of the files that are read instead of mapped
+	vector<char> buffer;
+
+	// Files smaller than this are read()
+	static const size_t MMAP_THRESHOLD = 16 * 1024;
+
+
+	bool read_all(int fd, size_t size) {
+		buffer.resize(size);
+		size_t total = 0;
+		while (total < size) {
+			ssize_t n = ::read(fd, buffer.data() + total, size - total);
+			if (n <= 0) {
+				break;
+			}
+			total += n;
+		}
+		buffer.resize(total);
+		bytes = buffer.data();
+		num_bytes = total;
+		return total == size;
+	}
+
+public:
+
+	MappedFile() {
+
+	}
+
+	MappedFile(const string& file_path, bool sequential = true) {
+		open(file_path, sequential);
+	}
+
+	~MappedFile() {
+		close();
+	}
+
+	// A MappedFile owns its mapping, so it can't be copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+
+	bool open(const string& file_path, bool sequential = true) {
+		close();
+
+		int fd = ::open(file_path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+
+		struct stat filestat;
+		if (fstat(fd, &filestat) != 0) {
+			::close(fd);
+			return false;
+		}
+		size_t size = filestat.st_size;
+
+		if (size >= MMAP_THRESHOLD) {
+			void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr != MAP_FAILED) {
+				madvise(addr, size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+				bytes = (const char*) addr;
+				num_bytes = size;
+				mapped = true;
+			}
+		}
+
+		if (!mapped) {
+			read_all(fd, size);
+		}
+
+		::close(fd);
+		opened = true;
+		return true;
+	}
+
+
+	void close() {
+		if (mapped) {
+			munmap((void*) bytes, num_bytes);
+		}
+		bytes = nullptr;
+		num_bytes = 0;
+		mapped = false;
+		opened = false;
+		vector<char>().swap(buffer);
+	}
+
+
+	bool is_open() { return opened; }
+	const char* data() { return num_bytes == 0 ? "" : bytes; }
+	size_t size() { return num_bytes; }
+	const char* begin() { return data(); }
+	const char* end() { return data() + num_bytes; }
+
+};
+
+
+
+// A MappedStreamBuf lets an istream read a range of bytes already in memory, e.g. a MappedFile, for the parsers that only
+// take a stream. The bytes are read in place, nothing is copied until the stream is read
+class MappedStreamBuf : public streambuf {
+
+public:
+	MappedStreamBuf(const char* first, const char* last) {
+		// The get area is only read from, streambuf just doesn't have a const one
+		char* begin = const_cast<char*>(first);
+		setg(begin, begin, begin + (last - first));
+	}
+
+};
+
+
+#endif
@@ -6,16 +6,25 @@
 #include <string>
 #include <unordered_map>
 
+#include "DocumentTable.h"
+#include "PostingList.h"
+
 using namespace std;
 
 // Each Node represents a unique word from the articles
 struct Node {
     
     string data;
-    vector<string> id_list;
-    // The count of this word in each article. The key is a paper id and the value is the count of this word in that paper id 
-    // For relevancy ranking 
-    //unordered_map<string, int> word_count_map;
+    // The ids of the documents this word appeared in, compressed once the index is built (see AVLTree::seal())
+    PostingList postings;
+    // The ids added since the postings were last sealed, in the order they were indexed
+    vector<DocId> id_list;
+    // The number of times the word appeared in each document of id_list
+    vector<uint32_t> freq_list;
+    // The positions of the word in each document of id_list, freq_list.at(i) of them for the i-th document
+    vector<uint32_t> position_list;
+    // False once a document was added without its positions (restored from the old text index), the word then has no positions
+    bool has_positions = true;
 
     // The total count of this word in the whole dataset 
     // For finding the top 50 frequent words indexed
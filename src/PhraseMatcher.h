@@ -0,0 +1,143 @@
+#ifndef PHRASEMATCHER_H
+#define PHRASEMATCHER_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "DocumentTable.h"
+#include "PostingList.h"
+#include "LiveDocs.h"
+
+using namespace std;
+
+
+// PhraseMatcher finds the documents where the words of a phrase appear next to each other. Each word of the phrase has an
+// offset, its distance from the first word counted in tokens (the stop words of the phrase aren't looked up but still take a
+// position, the same way they do in the index).
+//  - the posting lists are intersected first, the smallest list leads and the other iterators jump to its documents, so the
+//    positions of a document are only decoded when every word is in it
+//  - then the starts of the phrase are the positions of the word with the fewest positions minus its offset, and the positions
+//    of every other word have to contain each start plus their offset. Both are sorted, so the positions are searched by
+//    galloping (doubling the step, then a binary search), which skips over the positions of a frequent word
+// The lists have to be in the same segment of the index, and have positions
+class PhraseMatcher {
+
+private:
+	struct Term {
+		PostingList::Iterator it;
+		uint32_t offset;
+	};
+
+	vector<Term> terms;
+	vector<uint32_t> starts;
+
+
+	// The index of the first value of values[from, n) that is not less than target, n if there is none
+	static int gallop(const uint32_t* values, int n, int from, uint32_t target) {
+		int step = 1;
+		int end = from;
+		while (end < n && values[end] < target) {
+			from = end + 1;
+			end += step;
+			step *= 2;
+		}
+		return lower_bound(values + from, values + min(end, n), target) - values;
+	}
+
+
+	// Whether the phrase starts somewhere in the document all the iterators are on
+	bool verify() {
+
+		// The word with the fewest positions gives the candidate starts
+		int first = 0;
+		for (int t = 1; t < terms.size(); t += 1) {
+			if (terms.at(t).it.freq() < terms.at(first).it.freq()) {
+				first = t;
+			}
+		}
+
+		starts.clear();
+		const uint32_t* positions = terms.at(first).it.positions();
+		for (int i = 0; i < terms.at(first).it.freq(); i += 1) {
+			if (positions[i] >= terms.at(first).offset) {
+				starts.push_back(positions[i] - terms.at(first).offset);
+			}
+		}
+
+		for (int t = 0; t < terms.size() && !starts.empty(); t += 1) {
+			if (t == first) {
+				continue;
+			}
+			positions = terms.at(t).it.positions();
+			int n = terms.at(t).it.freq();
+			int p = 0;
+			int kept = 0;
+			for (int i = 0; i < starts.size() && p < n; i += 1) {
+				p = gallop(positions, n, p, starts.at(i) + terms.at(t).offset);
+				if (p < n && positions[p] == starts.at(i) + terms.at(t).offset) {
+					starts.at(kept) = starts.at(i);
+					kept += 1;
+				}
+			}
+			starts.resize(kept);
+		}
+
+		return !starts.empty();
+	}
+
+public:
+
+	// Adds a word of the phrase, offset tokens after the first one. Returns false if its list doesn't have positions
+	bool add_term(const PostingList& list, uint32_t offset, const LiveDocs* live_docs) {
+		if (!list.has_positions()) {
+			return false;
+		}
+		terms.push_back(Term{PostingList::Iterator(list, live_docs), offset});
+		return true;
+	}
+
+
+	// Appends the documents that have the phrase to docs, in increasing order
+	void match(vector<DocId>& docs) {
+
+		if (terms.empty()) {
+			return;
+		}
+		// The iterators are put in the order of their list sizes, so the smallest list leads the intersection
+		vector<int> order;
+		for (int t = 0; t < terms.size(); t += 1) {
+			order.push_back(t);
+		}
+		sort(order.begin(), order.end(), [this](int a, int b) { return terms.at(a).it.get_list().size() < terms.at(b).it.get_list().size(); });
+
+		PostingList::Iterator& lead = terms.at(order.at(0)).it;
+		while (!lead.at_end()) {
+			DocId doc = lead.doc();
+			bool all_in = true;
+			for (int i = 1; i < order.size(); i += 1) {
+				PostingList::Iterator& it = terms.at(order.at(i)).it;
+				it.advance(doc);
+				if (it.at_end()) {
+					return;
+				}
+				if (it.doc() != doc) {
+					// The next document that can have every word
+					lead.advance(it.doc());
+					all_in = false;
+					break;
+				}
+			}
+			if (all_in) {
+				if (verify()) {
+					docs.push_back(doc);
+				}
+				lead.next();
+			}
+		}
+	}
+
+};
+
+
+#endif
@@ -0,0 +1,539 @@
+#ifndef POSTINGLIST_H
+#define POSTINGLIST_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+#include "DocumentTable.h"
+#include "BlockCodec.h"
+#include "LiveDocs.h"
+
+using namespace std;
+
+
+// A PostingList is the immutable, compressed list of the documents a word appeared in, with the number of times the word
+// appeared in each of them (its term frequency, for ranking).
+// The document ids are sorted and cut into blocks of BLOCK_SIZE ids. Inside a block, every id is stored as the gap from the
+// id before it (the first one from the last id of the previous block). Since the ids of a frequent word are close to each
+// other, most gaps fit in one byte instead of four.
+// The blocks of a list are all stored with the same BlockCodec, picked when the list is encoded: lists shorter than a block
+// use variable-byte code, which is the smallest for them and is decoded fast enough. Longer lists use Stream VByte, which is
+// decoded with SIMD shuffles about 3 times faster than the others, unless PFOR packs them in less than half the bytes.
+// The last id of every block is kept uncompressed next to the byte offset of the block, in a table in front of the gaps, so an
+// Iterator can skip over the blocks that can't hold the id it is looking for without decoding them. The table also keeps the
+// largest term frequency of every block, which bounds the score any document of the block can get (see BlockMaxWand.h).
+// A list with a single block (most words only appear in a handful of articles) doesn't have that table at all.
+// The term frequencies come after the gaps of all the blocks, in variable-byte code (almost all of them are a single byte), one
+// block of them per block of ids. They are only decoded when they are asked for, so a boolean query never reads them.
+// A list can also hold the positions of the word in each document (its token offsets, counting the stop words), for phrase
+// queries. They come last, one block per block of ids, each document's positions as gaps in variable-byte code. The lists
+// restored from the old text index don't have them.
+// A list either owns its bytes, or is a view on the bytes of an index file mapped in memory (see IndexFile.h). The bytes of a
+// view are only read from the disk when the list is decoded.
+class PostingList {
+
+public:
+	static constexpr int BLOCK_SIZE = 128;
+
+private:
+	struct Block {
+		DocId last_doc;
+		uint32_t offset;
+		uint32_t freq_offset;
+		uint32_t max_freq;
+		uint32_t positions_offset;
+	};
+
+	// The table of blocks (when there is more than one block), the gaps of all the blocks, then the term frequencies of all the
+	// blocks
+	vector<unsigned char> bytes;
+	// The same layout in bytes the list doesn't own, when it is a view
+	const unsigned char* view = nullptr;
+	uint32_t view_size = 0;
+	int num_docs = 0;
+	DocId last_doc = 0;
+	// Where the term frequencies start, which is also the number of bytes taken by the ids
+	uint32_t freqs_offset = 0;
+	// The largest term frequency of the list
+	uint32_t max_freq = 0;
+	// Where the positions start, NO_POSITIONS if the list doesn't have them
+	uint32_t positions_offset = NO_POSITIONS;
+	BlockCodec::Codec codec = BlockCodec::VARINT;
+
+
+	bool has_block_table() const {
+		return num_docs > BLOCK_SIZE;
+	}
+
+	Block get_block(int b) const {
+		Block block;
+		memcpy(&block, data() + b * sizeof(Block), sizeof(Block));
+		return block;
+	}
+
+
+	// The codec a list of sorted document ids is stored with
+	static BlockCodec::Codec pick_codec(const vector<DocId>& docs) {
+		if (docs.size() < BLOCK_SIZE) {
+			return BlockCodec::VARINT;
+		}
+
+		// The sizes of the document ids with each codec, from the bit widths of the gaps, so the list is only encoded once
+		uint32_t gaps[BLOCK_SIZE];
+		int num_blocks = (docs.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		long long table_size = (docs.size() > BLOCK_SIZE) ? num_blocks * sizeof(Block) : 0;
+		long long stream_vbyte_size = table_size;
+		long long pfor_size = table_size;
+		DocId prev = 0;
+		for (int first = 0; first < (int) docs.size(); first += BLOCK_SIZE) {
+			int n = min(BLOCK_SIZE, (int) docs.size() - first);
+			for (int i = 0; i < n; i += 1) {
+				gaps[i] = docs.at(first + i) - prev;
+				prev = docs.at(first + i);
+			}
+			stream_vbyte_size += BlockCodec::encoded_size(BlockCodec::STREAM_VBYTE, gaps, n);
+			pfor_size += BlockCodec::encoded_size(BlockCodec::PFOR, gaps, n);
+		}
+		return (pfor_size * 2 <= stream_vbyte_size) ? BlockCodec::PFOR : BlockCodec::STREAM_VBYTE;
+	}
+
+
+	static void encode_varints(const uint32_t* values, int n, vector<unsigned char>& out) {
+		for (int i = 0; i < n; i += 1) {
+			uint32_t value = values[i];
+			while (value >= 128) {
+				out.push_back((value & 127) | 128);
+				value >>= 7;
+			}
+			out.push_back(value);
+		}
+	}
+
+	static const unsigned char* decode_varints(const unsigned char* in, int n, uint32_t* out) {
+		for (int i = 0; i < n; i += 1) {
+			uint32_t value = 0;
+			int shift = 0;
+			while (*in & 128) {
+				value |= (uint32_t) (*in & 127) << shift;
+				shift += 7;
+				in += 1;
+			}
+			out[i] = value | ((uint32_t) *in << shift);
+			in += 1;
+		}
+		return in;
+	}
+
+public:
+	static constexpr uint32_t NO_POSITIONS = UINT32_MAX;
+
+	PostingList() {
+
+	}
+
+	// docs has to be sorted, every term frequency is 1
+	PostingList(const vector<DocId>& docs) {
+		encode(docs);
+	}
+
+	// docs has to be sorted, freqs holds the term frequency of each document
+	PostingList(const vector<DocId>& docs, const vector<uint32_t>& freqs) {
+		encode(docs, freqs);
+	}
+
+	// docs has to be sorted, freqs holds the term frequency of each document and positions the positions in each document
+	PostingList(const vector<DocId>& docs, const vector<uint32_t>& freqs, const vector<uint32_t>& positions) {
+		encode(docs, freqs, positions);
+	}
+
+	// A view on the num_bytes bytes of an encoded list, which have to stay valid as long as the view is used
+	PostingList(const unsigned char* bytes, uint32_t num_bytes, int num_docs, DocId last_doc, uint32_t freqs_offset, uint32_t max_freq,
+		uint32_t positions_offset, BlockCodec::Codec codec) {
+		this->view = bytes;
+		this->view_size = num_bytes;
+		this->num_docs = num_docs;
+		this->last_doc = last_doc;
+		this->freqs_offset = freqs_offset;
+		this->max_freq = max_freq;
+		this->positions_offset = positions_offset;
+		this->codec = codec;
+	}
+
+
+	// Replaces the list by the sorted document ids in docs, stored with the codec that suits them. Every term frequency is 1
+	void encode(const vector<DocId>& docs) {
+		encode(docs, vector<uint32_t>(), vector<uint32_t>(), pick_codec(docs));
+	}
+
+	// Replaces the list by the sorted document ids in docs, stored with the given codec. Every term frequency is 1
+	void encode(const vector<DocId>& docs, BlockCodec::Codec codec) {
+		encode(docs, vector<uint32_t>(), vector<uint32_t>(), codec);
+	}
+
+	// Replaces the list by the sorted document ids in docs and their term frequencies, stored with the codec that suits them
+	void encode(const vector<DocId>& docs, const vector<uint32_t>& freqs) {
+		encode(docs, freqs, vector<uint32_t>(), pick_codec(docs));
+	}
+
+	// The same with the positions of the word, freqs.at(i) of them for the i-th document, sorted within each document
+	void encode(const vector<DocId>& docs, const vector<uint32_t>& freqs, const vector<uint32_t>& positions) {
+		encode(docs, freqs, positions, pick_codec(docs));
+	}
+
+	// Replaces the list by the sorted document ids in docs, their term frequencies in freqs (every term frequency is 1 if freqs
+	// is empty) and their positions (the list has no positions if it is empty), stored with the given codec
+	void encode(const vector<DocId>& docs, const vector<uint32_t>& freqs, const vector<uint32_t>& positions, BlockCodec::Codec codec) {
+
+		bytes.clear();
+		view = nullptr;
+		view_size = 0;
+		num_docs = docs.size();
+		last_doc = docs.empty() ? 0 : docs.back();
+		this->codec = codec;
+
+		// Leave room for the block table, it is filled in as the blocks are written
+		int table_size = has_block_table() ? num_blocks() * sizeof(Block) : 0;
+		bytes.resize(table_size);
+
+		uint32_t gaps[BLOCK_SIZE];
+		DocId prev = 0;
+		for (int b = 0; b < num_blocks(); b += 1) {
+			Block block{0, (uint32_t) bytes.size(), 0, 0, 0};
+
+			for (int i = 0; i < block_size(b); i += 1) {
+				gaps[i] = docs.at(b * BLOCK_SIZE + i) - prev;
+				prev = docs.at(b * BLOCK_SIZE + i);
+			}
+			BlockCodec::encode(codec, gaps, block_size(b), bytes);
+
+			block.last_doc = prev;
+			if (has_block_table()) {
+				memcpy(bytes.data() + b * sizeof(Block), &block, sizeof(Block));
+			}
+		}
+
+		freqs_offset = bytes.size();
+		max_freq = 0;
+		vector<uint32_t> ones(freqs.empty() ? min(num_docs, BLOCK_SIZE) : 0, 1);
+		for (int b = 0; b < num_blocks(); b += 1) {
+			const uint32_t* block_freqs = freqs.empty() ? ones.data() : freqs.data() + b * BLOCK_SIZE;
+			uint32_t block_max_freq = *max_element(block_freqs, block_freqs + block_size(b));
+			max_freq = max(max_freq, block_max_freq);
+			if (has_block_table()) {
+				uint32_t freq_offset = bytes.size();
+				memcpy(bytes.data() + b * sizeof(Block) + offsetof(Block, freq_offset), &freq_offset, sizeof(uint32_t));
+				memcpy(bytes.data() + b * sizeof(Block) + offsetof(Block, max_freq), &block_max_freq, sizeof(uint32_t));
+			}
+			encode_varints(block_freqs, block_size(b), bytes);
+		}
+
+		positions_offset = positions.empty() ? NO_POSITIONS : bytes.size();
+		vector<uint32_t> position_gaps;
+		size_t p = 0;
+		for (int b = 0; b < num_blocks() && !positions.empty(); b += 1) {
+			if (has_block_table()) {
+				uint32_t block_positions_offset = bytes.size();
+				memcpy(bytes.data() + b * sizeof(Block) + offsetof(Block, positions_offset), &block_positions_offset, sizeof(uint32_t));
+			}
+			for (int i = 0; i < block_size(b); i += 1) {
+				position_gaps.clear();
+				uint32_t prev_position = 0;
+				for (uint32_t j = 0; j < freqs.at(b * BLOCK_SIZE + i); j += 1) {
+					position_gaps.push_back(positions.at(p) - prev_position);
+					prev_position = positions.at(p);
+					p += 1;
+				}
+				encode_varints(position_gaps.data(), position_gaps.size(), bytes);
+			}
+		}
+
+		// The SIMD decoders read a little past the end of the last block
+		if (codec != BlockCodec::VARINT) {
+			bytes.resize(bytes.size() + BlockCodec::PADDING, 0);
+		}
+		bytes.shrink_to_fit();
+	}
+
+
+	int size() const {
+		return num_docs;
+	}
+
+	BlockCodec::Codec get_codec() const {
+		return codec;
+	}
+
+	DocId get_last_doc() const {
+		return last_doc;
+	}
+
+	uint32_t get_freqs_offset() const {
+		return freqs_offset;
+	}
+
+	uint32_t get_max_freq() const {
+		return max_freq;
+	}
+
+	bool has_positions() const {
+		return positions_offset != NO_POSITIONS;
+	}
+
+	uint32_t get_positions_offset() const {
+		return positions_offset;
+	}
+
+	// The encoded bytes of the list, as they are written to an index file
+	const unsigned char* data() const {
+		return view != nullptr ? view : bytes.data();
+	}
+
+	uint32_t num_bytes() const {
+		return view != nullptr ? view_size : bytes.size();
+	}
+
+	int num_blocks() const {
+		return (num_docs + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	}
+
+	int block_size(int b) const {
+		return min(BLOCK_SIZE, num_docs - b * BLOCK_SIZE);
+	}
+
+	DocId block_last_doc(int b) const {
+		return has_block_table() ? get_block(b).last_doc : last_doc;
+	}
+
+	uint32_t block_max_freq(int b) const {
+		return has_block_table() ? get_block(b).max_freq : max_freq;
+	}
+
+
+	// Decodes the ids of block b into out, which has room for BLOCK_SIZE ids, and returns how many there are
+	int decode_block(int b, DocId* out) const {
+
+		const unsigned char* in = data() + (has_block_table() ? get_block(b).offset : 0);
+		DocId base = (b == 0) ? 0 : block_last_doc(b - 1);
+		int n = block_size(b);
+
+		BlockCodec::decode(codec, in, n, base, out);
+		return n;
+	}
+
+
+	// Decodes the term frequencies of block b into out, which has room for BLOCK_SIZE of them
+	void decode_block_freqs(int b, uint32_t* out) const {
+		const unsigned char* in = data() + (has_block_table() ? get_block(b).freq_offset : freqs_offset);
+		decode_varints(in, block_size(b), out);
+	}
+
+
+	// Decodes the positions of block b into out, given the term frequencies of the block (see decode_block_freqs()). The
+	// positions of each document follow the ones of the document before it
+	void decode_block_positions(int b, const uint32_t* freqs, vector<uint32_t>& out) const {
+		const unsigned char* in = data() + (has_block_table() ? get_block(b).positions_offset : positions_offset);
+		for (int i = 0; i < block_size(b); i += 1) {
+			int begin = out.size();
+			out.resize(begin + freqs[i]);
+			in = decode_varints(in, freqs[i], out.data() + begin);
+			for (int j = begin + 1; j < out.size(); j += 1) {
+				out[j] += out[j - 1];
+			}
+		}
+	}
+
+
+	// Appends all the ids of the list to out
+	void decode(vector<DocId>& out) const {
+		int begin = out.size();
+		out.resize(begin + num_docs);
+		for (int b = 0; b < num_blocks(); b += 1) {
+			decode_block(b, out.data() + begin + b * BLOCK_SIZE);
+		}
+	}
+
+	// Appends all the ids of the list to out, and their term frequencies to freqs
+	void decode(vector<DocId>& out, vector<uint32_t>& freqs) const {
+		decode(out);
+		int begin = freqs.size();
+		freqs.resize(begin + num_docs);
+		for (int b = 0; b < num_blocks(); b += 1) {
+			decode_block_freqs(b, freqs.data() + begin + b * BLOCK_SIZE);
+		}
+	}
+
+	// Appends all the ids of the list to out, their term frequencies to freqs and their positions to positions, if it has any
+	void decode(vector<DocId>& out, vector<uint32_t>& freqs, vector<uint32_t>& positions) const {
+		int begin = freqs.size();
+		decode(out, freqs);
+		for (int b = 0; b < num_blocks() && has_positions(); b += 1) {
+			decode_block_positions(b, freqs.data() + begin + b * BLOCK_SIZE, positions);
+		}
+	}
+
+
+	// The number of bytes the list takes in memory, the bytes of a view are in the mapped file
+	size_t memory_usage() const {
+		return sizeof(PostingList) + bytes.capacity();
+	}
+
+
+
+	// Walks over the ids of a PostingList in increasing order, decoding one block at a time.
+	// Given the LiveDocs of the index, it steps over the deleted documents as if they weren't in the list
+	class Iterator {
+
+	private:
+		const PostingList* list;
+		const LiveDocs* live_docs;
+		int block = 0;
+		int pos = 0;
+		int count = 0;
+		DocId buffer[BLOCK_SIZE];
+		// The term frequencies of block freqs_block, decoded the first time one of them is asked for
+		int freqs_block = -1;
+		uint32_t freqs[BLOCK_SIZE];
+		// The same for the positions, the ones of the i-th id of the block start at position_starts[i]
+		int positions_block = -1;
+		vector<uint32_t> block_positions;
+		int position_starts[BLOCK_SIZE];
+
+		void load_freqs() {
+			if (freqs_block != block) {
+				list->decode_block_freqs(block, freqs);
+				freqs_block = block;
+			}
+		}
+
+		void load(int b) {
+			block = b;
+			pos = 0;
+			count = (b < list->num_blocks()) ? list->decode_block(b, buffer) : 0;
+		}
+
+		void skip_deleted() {
+			while (live_docs != nullptr && !at_end() && !live_docs->is_live(buffer[pos])) {
+				pos += 1;
+				if (pos == count) {
+					load(block + 1);
+				}
+			}
+		}
+
+	public:
+
+		Iterator(const PostingList& list, const LiveDocs* live_docs = nullptr) {
+			this->list = &list;
+			this->live_docs = live_docs;
+			load(0);
+			skip_deleted();
+		}
+
+		bool at_end() const {
+			return pos >= count;
+		}
+
+		// The current id, only valid when the iterator isn't at the end
+		DocId doc() const {
+			return buffer[pos];
+		}
+
+		// The term frequency of the current id
+		uint32_t freq() {
+			load_freqs();
+			return freqs[pos];
+		}
+
+		// The sorted positions of the word in the current document, there are freq() of them. The list has to have positions
+		const uint32_t* positions() {
+			if (positions_block != block) {
+				load_freqs();
+				block_positions.clear();
+				list->decode_block_positions(block, freqs, block_positions);
+				int start = 0;
+				for (int i = 0; i < count; i += 1) {
+					position_starts[i] = start;
+					start += freqs[i];
+				}
+				positions_block = block;
+			}
+			return block_positions.data() + position_starts[pos];
+		}
+
+		void next() {
+			pos += 1;
+			if (pos == count) {
+				load(block + 1);
+			}
+			skip_deleted();
+		}
+
+		const PostingList& get_list() const {
+			return *list;
+		}
+
+		// The block that holds the first id >= target, without moving the iterator or decoding anything. It is num_blocks() if
+		// every id of the list is smaller than target.
+		// The last ids of the blocks are searched by galloping from the current block: the step doubles until a block ends at or
+		// after target, then a binary search between the last two steps, so a jump over many blocks reads O(log) of them
+		int find_block(DocId target) const {
+			int n = list->num_blocks();
+			if (block >= n || list->block_last_doc(block) >= target) {
+				return block;
+			}
+
+			// Every block before low ends before target
+			int low = block + 1;
+			int high = low;
+			int step = 1;
+			while (high < n && list->block_last_doc(high) < target) {
+				low = high + 1;
+				high += step;
+				step *= 2;
+			}
+			high = min(high, n);
+
+			// The first block of [low, high) that ends at or after target, high if there is none
+			while (low < high) {
+				int mid = low + (high - low) / 2;
+				if (list->block_last_doc(mid) < target) {
+					low = mid + 1;
+				}
+				else {
+					high = mid;
+				}
+			}
+			return low;
+		}
+
+		// Moves to the first id >= target. Blocks whose last id is smaller than target are skipped without being decoded
+		void advance(DocId target) {
+			if (at_end() || doc() >= target) {
+				return;
+			}
+
+			int b = find_block(target);
+			if (b != block) {
+				load(b);
+				if (at_end()) {
+					return;
+				}
+			}
+
+			// The last id of the block is >= target, so this stops inside the block
+			while (buffer[pos] < target) {
+				pos += 1;
+			}
+			skip_deleted();
+		}
+
+	};
+
+};
+
+
+#endif
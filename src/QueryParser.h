@@ -0,0 +1,314 @@
+#ifndef QUERYPARSER_H
+#define QUERYPARSER_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cctype>
+
+#include "TextNormalizer.h"
+#include "StopWords.h"
+#include "StemCache.h"
+
+using namespace std;
+
+
+// A node of the operator tree of a query
+struct QueryNode {
+
+	enum Type { TERM, PHRASE, AND, OR, NOT, AUTHOR };
+
+	Type type = AND;
+	// The search term (stemmed once the query is prepared), the text of a phrase or the last name of an author
+	string text;
+	// The stemmed words of a phrase, without its stop words, and their offsets from the first one (see PhraseMatcher.h)
+	vector<string> words;
+	vector<uint32_t> offsets;
+	// The operands of AND and OR, the one operand of NOT
+	vector<QueryNode> children;
+
+
+	// Appends the search terms the matches are ranked by, the words of the terms and phrases that aren't under a NOT
+	void get_search_terms(vector<string>& terms) const {
+		if (type == TERM) {
+			terms.push_back(text);
+		}
+		else if (type == PHRASE) {
+			terms.insert(terms.end(), words.begin(), words.end());
+		}
+		else if (type == AND || type == OR) {
+			for (int i = 0; i < children.size(); i += 1) {
+				children.at(i).get_search_terms(terms);
+			}
+		}
+	}
+
+};
+
+
+
+// The QueryParser turns a prefix Boolean query into its operator tree. The query is split into tokens first: the operators
+// AND, OR, NOT and AUTHOR (in capitals), the parentheses, the phrases in double quotes and the words. The grammar is
+//   query    := expr filter*
+//   expr     := AND operand+ | OR operand+ | operand
+//   operand  := word | "phrase" | ( query ) | expr
+//   filter   := NOT operand | AUTHOR word+
+// The filters apply to the whole query (or to the whole parenthesized query they are in), so the query becomes an AND of the
+// expression and its filters, e.g. OR cell protein NOT virus AUTHOR Liu is AND(OR(cell, protein), NOT(virus), AUTHOR(Liu)).
+// Without parentheses, an AND or OR that is an operand takes every operand after it. There can be any number of NOT and AUTHOR,
+// and an author's last name can have several words.
+// prepare() then normalizes the words the same way as the texts of the articles, so they can be looked up in the index
+class QueryParser {
+
+private:
+	enum TokenType { WORD, PHRASE, AND, OR, NOT, AUTHOR, OPEN, CLOSE, END };
+
+	struct Token {
+		TokenType type;
+		string text;
+	};
+
+	vector<Token> tokens;
+	int next = 0;
+	string error;
+	TextNormalizer normalizer;
+
+
+	void tokenize(const string& query) {
+		tokens.clear();
+		int i = 0;
+		while (i < query.size()) {
+			if (isspace((unsigned char) query[i])) {
+				i += 1;
+			}
+			else if (query[i] == '(' || query[i] == ')') {
+				tokens.push_back(Token{query[i] == '(' ? OPEN : CLOSE, string(1, query[i])});
+				i += 1;
+			}
+			else if (query[i] == '"') {
+				int end = query.find('"', i + 1);
+				if (end == string::npos) {
+					error = "a phrase is missing its closing double quote";
+					end = query.size();
+				}
+				tokens.push_back(Token{PHRASE, query.substr(i + 1, end - i - 1)});
+				i = end + 1;
+			}
+			else {
+				int begin = i;
+				while (i < query.size() && !isspace((unsigned char) query[i]) && query[i] != '(' && query[i] != ')' && query[i] != '"') {
+					i += 1;
+				}
+				string word = query.substr(begin, i - begin);
+				TokenType type = WORD;
+				if (word == "AND") {
+					type = AND;
+				}
+				else if (word == "OR") {
+					type = OR;
+				}
+				else if (word == "NOT") {
+					type = NOT;
+				}
+				else if (word == "AUTHOR") {
+					type = AUTHOR;
+				}
+				tokens.push_back(Token{type, word});
+			}
+		}
+		tokens.push_back(Token{END, ""});
+	}
+
+	TokenType peek() {
+		return tokens.at(next).type;
+	}
+
+	bool starts_operand() {
+		return peek() == WORD || peek() == PHRASE || peek() == OPEN || peek() == AND || peek() == OR;
+	}
+
+
+	bool parse_query(QueryNode& node) {
+
+		// A query can be only filters, e.g. AUTHOR Bai
+		if (peek() == NOT || peek() == AUTHOR) {
+			node.type = QueryNode::AND;
+		}
+		else if (!parse_expression(node)) {
+			return false;
+		}
+
+		if (peek() != NOT && peek() != AUTHOR) {
+			return true;
+		}
+		if (node.type != QueryNode::AND) {
+			QueryNode expression = node;
+			node = QueryNode();
+			node.type = QueryNode::AND;
+			node.children.push_back(expression);
+		}
+		while (peek() == NOT || peek() == AUTHOR) {
+			QueryNode filter;
+			if (!parse_filter(filter)) {
+				return false;
+			}
+			node.children.push_back(filter);
+		}
+		return true;
+	}
+
+	bool parse_expression(QueryNode& node) {
+
+		if (peek() != AND && peek() != OR) {
+			return parse_operand(node);
+		}
+
+		string name = tokens.at(next).text;
+		node.type = (peek() == AND) ? QueryNode::AND : QueryNode::OR;
+		next += 1;
+		while (starts_operand()) {
+			QueryNode operand;
+			if (!parse_operand(operand)) {
+				return false;
+			}
+			node.children.push_back(operand);
+		}
+		if (node.children.empty()) {
+			error = name + " needs at least one search term";
+			return false;
+		}
+		// AND or OR of a single operand is the operand
+		if (node.children.size() == 1) {
+			QueryNode operand = node.children.at(0);
+			node = operand;
+		}
+		return true;
+	}
+
+	bool parse_operand(QueryNode& node) {
+
+		if (peek() == WORD || peek() == PHRASE) {
+			node.type = (peek() == WORD) ? QueryNode::TERM : QueryNode::PHRASE;
+			node.text = tokens.at(next).text;
+			next += 1;
+			return true;
+		}
+		if (peek() == AND || peek() == OR) {
+			return parse_expression(node);
+		}
+		if (peek() == OPEN) {
+			next += 1;
+			if (!parse_query(node)) {
+				return false;
+			}
+			if (peek() != CLOSE) {
+				error = "a parenthesis is missing its closing parenthesis";
+				return false;
+			}
+			next += 1;
+			return true;
+		}
+
+		if (peek() == END) {
+			error = "a search term is missing at the end of the query";
+		}
+		else {
+			error = "expected a search term before " + tokens.at(next).text;
+		}
+		return false;
+	}
+
+	bool parse_filter(QueryNode& node) {
+
+		if (peek() == NOT) {
+			next += 1;
+			node.type = QueryNode::NOT;
+			node.children.push_back(QueryNode());
+			return parse_operand(node.children.at(0));
+		}
+
+		next += 1;
+		node.type = QueryNode::AUTHOR;
+		while (peek() == WORD) {
+			node.text += (node.text.empty() ? "" : " ") + tokens.at(next).text;
+			next += 1;
+		}
+		if (node.text.empty()) {
+			error = "AUTHOR needs a last name";
+			return false;
+		}
+		return true;
+	}
+
+
+	// The words of text as the index has them: normalized, without the stop words and stemmed, with their token offsets
+	void normalize(string text, StopWordSet& stop_words, StemCache& stem_cache, vector<string>& words, vector<uint32_t>& offsets) {
+		vector<TokenView>& text_tokens = normalizer.normalize(text);
+		for (int i = 0; i < text_tokens.size(); i += 1) {
+			string_view token(text.data() + text_tokens.at(i).offset, text_tokens.at(i).length);
+			if (!stop_words.contains(token)) {
+				words.push_back(string(token));
+				offsets.push_back(i);
+			}
+		}
+		// Backwards, so the offset of the first word is the last one to become 0
+		for (int i = words.size() - 1; i >= 0; i -= 1) {
+			stem_cache.stem(words.at(i));
+			offsets.at(i) -= offsets.at(0);
+		}
+	}
+
+public:
+
+	// Parses query into root. Returns false if it isn't a well formed query, get_error() says why
+	bool parse(const string& query, QueryNode& root) {
+		error = "";
+		next = 0;
+		root = QueryNode();
+		tokenize(query);
+		if (!error.empty()) {
+			return false;
+		}
+		if (peek() == END) {
+			error = "the query is empty";
+			return false;
+		}
+		if (!parse_query(root)) {
+			return false;
+		}
+		if (peek() != END) {
+			error = "unexpected " + tokens.at(next).text + " after the end of the query";
+			return false;
+		}
+		return true;
+	}
+
+	string get_error() {
+		return error;
+	}
+
+
+	// Turns the words of the terms and phrases of the tree into the words of the index. The normalizer drops the punctuation
+	// and the digits of a term without splitting it (e.g. mers-cov is looked up as merscov, like in the texts), so a term stays
+	// one word. A term that is a stop word, or has no letters, is left as it is and is not found
+	void prepare(QueryNode& node, StopWordSet& stop_words, StemCache& stem_cache) {
+		if (node.type == QueryNode::TERM) {
+			vector<string> words;
+			vector<uint32_t> offsets;
+			normalize(node.text, stop_words, stem_cache, words, offsets);
+			if (!words.empty()) {
+				node.text = words.at(0);
+			}
+		}
+		else if (node.type == QueryNode::PHRASE) {
+			normalize(node.text, stop_words, stem_cache, node.words, node.offsets);
+		}
+		for (int i = 0; i < node.children.size(); i += 1) {
+			prepare(node.children.at(i), stop_words, stem_cache);
+		}
+	}
+
+};
+
+
+#endif
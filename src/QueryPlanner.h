@@ -0,0 +1,219 @@
+#ifndef QUERYPLANNER_H
+#define QUERYPLANNER_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "SegmentedIndex.h"
+#include "PostingList.h"
+#include "PhraseMatcher.h"
+#include "QueryParser.h"
+#include "Intersection.h"
+
+using namespace std;
+
+
+// The QueryPlanner evaluates the operator tree of a query (see QueryParser.h) over one segment of the index, into the sorted
+// document ids that match it, without the deleted ones. The plan comes from the cost of each node, the number of documents it
+// can match as the posting lists tell it (their lengths are the document frequencies):
+//  - a term costs its document frequency, a phrase the smallest one of its words, an author its number of articles
+//  - an OR costs the sum of its operands, an AND its cheapest operand
+// An AND runs its operands from the cheapest one up. Only the cheapest one is evaluated, into the candidates, and every other
+// operand filters them, so the work is bounded by the cheapest operand instead of the longest list. A term much longer than
+// the candidates filters them with an iterator that jumps from one candidate to the next, without decoding the blocks of its
+// list in between. A term of about the same length is decoded and intersected with the candidates (see Intersection.h).
+// NOT and AUTHOR are pushed down the same way: a NOT drops the candidates its operand matches, and an author keeps the candidates
+// that are its articles (or drives the AND when it is the cheapest operand)
+class QueryPlanner {
+
+private:
+	Segment& segment;
+	const LiveDocs& live_docs;
+	vector<DocId> decoded;
+
+
+	// Appends the articles of an author, sorted. An author can be listed twice on the same article
+	void get_author_docs(const string& author, vector<DocId>& out) {
+		int begin = out.size();
+		segment.author_table.get_doc_ids(author, out);
+		sort(out.begin() + begin, out.end());
+		out.erase(unique(out.begin() + begin, out.end()), out.end());
+		live_docs.remove_deleted(out, begin);
+	}
+
+
+	// Keeps the candidates that match node if keep is true, or the ones that don't if it is false
+	void filter(const QueryNode& node, bool keep, vector<DocId>& candidates) {
+
+		if (node.type == QueryNode::TERM) {
+			const PostingList* postings = segment.word_tree.get_postings(node.text);
+			if (postings == nullptr) {
+				if (keep) {
+					candidates.clear();
+				}
+				return;
+			}
+			// The candidates are live, so the deleted documents of the list don't matter
+			if (keep && (long long) candidates.size() * Intersection::GALLOP_RATIO > postings->size()) {
+				decoded.clear();
+				postings->decode(decoded);
+				Intersection::intersect(candidates, decoded);
+				return;
+			}
+			PostingList::Iterator it(*postings);
+			int kept = 0;
+			for (int j = 0; j < candidates.size(); j += 1) {
+				if (!it.at_end()) {
+					it.advance(candidates.at(j));
+				}
+				bool matches = !it.at_end() && it.doc() == candidates.at(j);
+				if (matches == keep) {
+					candidates.at(kept) = candidates.at(j);
+					kept += 1;
+				}
+			}
+			candidates.resize(kept);
+			return;
+		}
+
+		// The other nodes are evaluated whole, an author's articles are already decoded and the other ones need all of their
+		// operands
+		vector<DocId> matches;
+		evaluate(node, matches);
+		if (keep) {
+			Intersection::intersect(candidates, matches);
+		}
+		else {
+			vector<DocId> kept;
+			set_difference(candidates.begin(), candidates.end(), matches.begin(), matches.end(), back_inserter(kept));
+			candidates = kept;
+		}
+	}
+
+public:
+
+	QueryPlanner(Segment& segment, const LiveDocs& live_docs) : segment(segment), live_docs(live_docs) {
+
+	}
+
+
+	// The largest number of documents of the segment node can match
+	long long cost(const QueryNode& node) {
+
+		if (node.type == QueryNode::TERM) {
+			const PostingList* postings = segment.word_tree.get_postings(node.text);
+			return (postings != nullptr) ? postings->size() : 0;
+		}
+		if (node.type == QueryNode::PHRASE) {
+			long long smallest = 0;
+			for (int i = 0; i < node.words.size(); i += 1) {
+				const PostingList* postings = segment.word_tree.get_postings(node.words.at(i));
+				if (postings == nullptr) {
+					return 0;
+				}
+				smallest = (i == 0) ? postings->size() : min(smallest, (long long) postings->size());
+			}
+			return smallest;
+		}
+		if (node.type == QueryNode::AUTHOR) {
+			vector<DocId> docs;
+			segment.author_table.get_doc_ids(node.text, docs);
+			return docs.size();
+		}
+
+		// A NOT alone matches nothing, the documents without a term aren't listed anywhere
+		long long total = 0;
+		bool first = true;
+		for (int i = 0; i < node.children.size() && node.type != QueryNode::NOT; i += 1) {
+			if (node.children.at(i).type == QueryNode::NOT) {
+				continue;
+			}
+			long long child_cost = cost(node.children.at(i));
+			if (node.type == QueryNode::OR) {
+				total += child_cost;
+			}
+			else {
+				total = first ? child_cost : min(total, child_cost);
+			}
+			first = false;
+		}
+		return total;
+	}
+
+
+	// Appends the documents of the segment that match node to out, sorted
+	void evaluate(const QueryNode& node, vector<DocId>& out) {
+
+		if (node.type == QueryNode::TERM || (node.type == QueryNode::PHRASE && node.words.size() == 1)) {
+			const PostingList* postings = segment.word_tree.get_postings(node.type == QueryNode::TERM ? node.text : node.words.at(0));
+			if (postings != nullptr) {
+				int begin = out.size();
+				postings->decode(out);
+				live_docs.remove_deleted(out, begin);
+			}
+		}
+
+		else if (node.type == QueryNode::PHRASE) {
+			PhraseMatcher matcher;
+			for (int i = 0; i < node.words.size(); i += 1) {
+				const PostingList* postings = segment.word_tree.get_postings(node.words.at(i));
+				// A word that isn't in the segment, or a list without positions (restored from the old text index)
+				if (postings == nullptr || !matcher.add_term(*postings, node.offsets.at(i), &live_docs)) {
+					return;
+				}
+			}
+			matcher.match(out);
+		}
+
+		else if (node.type == QueryNode::AUTHOR) {
+			get_author_docs(node.text, out);
+		}
+
+		else if (node.type == QueryNode::OR) {
+			vector<DocId> matches;
+			for (int i = 0; i < node.children.size(); i += 1) {
+				vector<DocId> child_matches;
+				evaluate(node.children.at(i), child_matches);
+				vector<DocId> merged;
+				set_union(matches.begin(), matches.end(), child_matches.begin(), child_matches.end(), back_inserter(merged));
+				matches = merged;
+			}
+			out.insert(out.end(), matches.begin(), matches.end());
+		}
+
+		else if (node.type == QueryNode::AND) {
+
+			// The operands from the cheapest one, then the NOT filters
+			vector<int> order;
+			vector<long long> costs(node.children.size(), 0);
+			for (int i = 0; i < node.children.size(); i += 1) {
+				if (node.children.at(i).type != QueryNode::NOT) {
+					costs.at(i) = cost(node.children.at(i));
+					order.push_back(i);
+				}
+			}
+			if (order.empty()) {
+				return;
+			}
+			stable_sort(order.begin(), order.end(), [&costs](int a, int b) { return costs.at(a) < costs.at(b); });
+
+			vector<DocId> candidates;
+			evaluate(node.children.at(order.at(0)), candidates);
+			for (int i = 1; i < order.size() && !candidates.empty(); i += 1) {
+				filter(node.children.at(order.at(i)), true, candidates);
+			}
+			for (int i = 0; i < node.children.size() && !candidates.empty(); i += 1) {
+				if (node.children.at(i).type == QueryNode::NOT) {
+					filter(node.children.at(i).children.at(0), false, candidates);
+				}
+			}
+			out.insert(out.end(), candidates.begin(), candidates.end());
+		}
+	}
+
+};
+
+
+#endif
@@ -11,11 +11,29 @@
 #include <cctype>
 #include <unordered_map>
 #include <map>
+#include <thread>
 
 #include "Article.h"   
 #include "AVLTree.h"
 #include "Node.h"
 #include "HashTable.h"
+#include "DocumentStore.h"
+#include "DocumentTable.h"
+#include "JsonExtractor.h"
+#include "MappedFile.h"
+#include "TextNormalizer.h"
+#include "StemCache.h"
+#include "StopWords.h"
+#include "IndexFile.h"
+#include "SegmentedIndex.h"
+#include "BM25.h"
+#include "TopK.h"
+#include "BlockMaxWand.h"
+#include "PhraseMatcher.h"
+#include "CoveringSpan.h"
+#include "QueryParser.h"
+#include "QueryPlanner.h"
+#include "Intersection.h"
 
 #include "../utils/parser.hpp" 		   // csv parser
 #include "../utils/json.hpp"    	   // json parser
@@ -31,60 +49,123 @@ using namespace aria::csv;
 using json = nlohmann::json;
 
 void display_menu();
-void restore_word_index(AVLTree& word_tree);
-void restore_author_index(HashTable& author_table);
-void display_statistics(int num_articles_indexed, int num_words_indexed, int num_stop_words, AVLTree& word_tree, HashTable& author_table);
+void restore_word_index(AVLTree& word_tree, DocumentTable& doc_table, int num_threads);
+void restore_author_index(HashTable& author_table, DocumentTable& doc_table, int num_threads);
+bool restore_records(string file_path, DocumentTable& doc_table, int num_threads, bool encode,
+	vector<string>& names, vector<vector<DocId>>& id_lists, vector<PostingList>& postings);
+void restore_partition(const char* begin, const char* end, DocumentTable& doc_table, bool encode,
+	vector<string>& names, vector<vector<DocId>>& id_lists, vector<PostingList>& postings);
+void display_statistics(int num_articles_indexed, int num_words_indexed, int num_stop_words, AVLTree& word_tree, HashTable& author_table, SegmentedIndex& index, StemCache& stem_cache);
 bool way_to_sort(Node*& lhs, Node*& rhs);
 
+// Defined in Benchmark.h
+void run_benchmarks(AVLTree& word_tree, DocumentTable& doc_table, BM25& bm25, const LiveDocs& live_docs);
+
 
 // The Index processor
-void index_processor(AVLTree& word_tree, HashTable& author_table, vector<Article>& articles, 
-	unordered_map<string, string>& published_date_map, unordered_map<string, string>& publication_map,
+void index_processor(AVLTree& word_tree, HashTable& author_table, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
+	int& num_articles_indexed, int& num_words_indexed, int& num_stop_words, int num_threads, StopWordSet& stop_words, StemCache& stem_cache);
+void index_files(vector<string>& file_paths, AVLTree& word_tree, HashTable& author_table, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
+	int& num_articles_indexed, int& num_words_indexed, int& num_stop_words, int num_threads, StopWordSet& stop_words, StemCache& stem_cache);
+void parse_partition(vector<string>& file_paths, vector<Article>& batch, vector<char>& parsed, int begin, int end);
+void index_partition(vector<Article>& batch, int begin, int end, DocId first_doc, StopWordSet& stop_words, StemCache& stem_cache,
+	AVLTree& word_tree, HashTable& author_table, vector<uint32_t>& lengths, vector<uint32_t>& word_counts, vector<uint32_t>& stop_word_counts);
+
+// Opening the index of the previous run instead of indexing the dataset again
+bool open_index(SegmentedIndex& index, IndexFile& index_file, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
 	int& num_articles_indexed, int& num_words_indexed, int& num_stop_words);
 
+// Adding documents to an index that is already built, as new segments
+void add_documents(string source, SegmentedIndex& index, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
+	int& num_articles_indexed, int& num_words_indexed, int& num_stop_words, int num_threads, StopWordSet& stop_words, StemCache& stem_cache);
+void restore_added_documents(SegmentedIndex& index, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
+	int& num_articles_indexed, int& num_words_indexed, int& num_stop_words, string old_store_path);
+
 // The Document processors
 void parse_csv(string file_path, unordered_map<string, string>& published_date_map, unordered_map<string, string>& publication_map);
-void parse_directory(string folder_path, vector<Article>& articles);
-Article parse_json(string& file_path);
+void parse_directory(string folder_path, vector<string>& file_paths);
+string get_file_paper_id(const string& file_path);
+bool parse_json(string& file_path, Article& article);
+Article parse_json_dom(string& file_path);
 
 // Helper functions for the document processors 
 void remove_punctuation(string& str);
 void to_lower(string& str);
 vector<string> tokenize(string& str);
-void load_stop_words(AVLTree& stop_words_tree);
-void stem_words(vector<string>& tokens);
-void remove_duplicates(vector<string>& tokens);
+void load_stop_words(StopWordSet& stop_words);
+void stem_words(vector<string>& tokens, StemCache& stem_cache);
+void remove_duplicates(vector<string>& tokens, vector<uint32_t>& positions, vector<uint32_t>& counts);
 
 // The Query processor and Search processor.
-void perform_search(vector<string>& final_matches, string user_query, string& temp, AVLTree& word_tree, HashTable& author_table);
+void perform_search(vector<DocId>& final_matches, QueryNode& query, SegmentedIndex& index);
+
+// Helper functions for search processor
+void report_missing_terms(const QueryNode& node, vector<shared_ptr<Segment>>& segments);
+bool is_or_query(const QueryNode& query, const QueryNode*& disjunction, vector<const QueryNode*>& filters);
 
-// Helper function for search processor
-vector<string> intersection(vector<vector<string>>& vecs);
+// Deleting articles and compacting the index
+void delete_documents(string paper_ids, SegmentedIndex& index, DocumentTable& doc_table);
+void compact_index(SegmentedIndex& index, DocumentTable& doc_table);
 
 // The Ranking processor
-void rank_results(vector<string>& final_matches, vector<Article>& articles, string& temp, vector<string>& top15_results);
+void rank_results(vector<DocId>& final_matches, SegmentedIndex& index, DocumentTable& doc_table, vector<string>& search_terms, BM25& bm25,
+	int k, vector<DocId>& top_results);
+void rank_or_query(const QueryNode& disjunction, vector<const QueryNode*>& filters, SegmentedIndex& index, DocumentTable& doc_table, 
+	BM25& bm25, int k, vector<DocId>& top_results);
 
-void display_results(vector<string>& top15_results, vector<Article>& articles, 
+void display_results(vector<DocId>& top15_results, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
 	unordered_map<string, string>& published_date_map, unordered_map<string, string>& publication_map);
 
 
 
 
 // The SearchEngine is responsible for declaring data structures, running the menu, and starting the search by calling other processors  
-void SearchEngine() {
-
-	AVLTree word_tree;
-	HashTable author_table(98317);
+// num_threads is the number of workers used to build the index (1 builds it sequentially), k1 and b are the parameters of the
+// BM25 ranking and proximity_weight is how much the ranking boosts the articles where the search terms are close (0 turns it off)
+void SearchEngine(int num_threads = thread::hardware_concurrency(), double k1 = BM25::DEFAULT_K1, double b = BM25::DEFAULT_B,
+	double proximity_weight = BM25::DEFAULT_PROXIMITY_WEIGHT) {
+
+	// The index of the dataset is the base segment of the index, the documents added later go into segments of their own
+	SegmentedIndex index(98317);
+	AVLTree& word_tree = index.get_base_words();
+	HashTable& author_table = index.get_base_authors();
+	// The articles only keep their metadata once they are indexed, their body texts are moved to the document store. The store
+	// is kept for the next run, with the metadata of the articles too
 	vector<Article> articles;
+	DocumentStore doc_store("document_store.txt");
+	// Gives every article a document id, the indexes store document ids instead of paper ids
+	DocumentTable doc_table;
+	// The index file the index is restored from, the restored posting lists point into its mapping
+	IndexFile index_file;
+	// Shared by the index processor, the query processor and the ranking processor
+	StemCache stem_cache;
+	StopWordSet stop_words;
+	load_stop_words(stop_words);
+	BM25 bm25(k1, b, proximity_weight);
 	unordered_map<string, string> published_date_map;
 	unordered_map<string, string> publication_map;
 
 	int num_articles_indexed = 0, num_words_indexed = 0, num_stop_words = 0;
 
-	cout << "Parsing data..." << endl << endl;
+	// Parse the metadata.csv, and create two maps, one maps "paper_id" to "published date", the other maps "paper_id" to "publication"
+	parse_csv("../dataset_small/metadata-cs2341.csv", published_date_map, publication_map);
+
+	// The index of the previous run is opened as it is if it is still the index of the dataset, otherwise the dataset is indexed again
+	if (open_index(index, index_file, articles, doc_store, doc_table, num_articles_indexed, num_words_indexed, num_stop_words)) {
+		cout << "Opened the index of " << num_articles_indexed << " articles." << endl << endl;
+	}
+	else {
+		cout << "Parsing data..." << endl << endl;
+
+		// The old store still has the articles added in the previous runs
+		doc_store.move_to("document_store.old");
+		index_processor(word_tree, author_table, articles, doc_store, doc_table, 
+			num_articles_indexed, num_words_indexed, num_stop_words, num_threads, stop_words, stem_cache);
 
-	index_processor(word_tree, author_table, articles, published_date_map, publication_map, 
-		num_articles_indexed, num_words_indexed, num_stop_words);
+		// The articles added and deleted in the previous runs are kept, if the dataset still has the same documents
+		restore_added_documents(index, articles, doc_store, doc_table, num_articles_indexed, num_words_indexed, num_stop_words, 
+			"document_store.old");
+	}
 
 
 	display_menu();
@@ -97,62 +178,134 @@ void SearchEngine() {
 
 		// Ask user to enter a search query
 		if (user_choice == '1') {
-			cout << "Please enter a properly formatted prefix Boolean query: ";
+			cout << "Please enter a properly formatted prefix Boolean query (a phrase goes in double quotes): ";
 			cin.ignore(); // When getline() reads from the input, there is a newline character left in the input stream from the previous cin 
 			string user_query;
 			getline(cin, user_query);
 			cout << endl;
 
-			vector<string> final_matches;
-			vector<string> top15_results;
-			// temp stores the untokenized search terms
-			string temp = "";
+			vector<DocId> final_matches;
+			vector<DocId> top15_results;
+			// The operator tree of the query
+			QueryNode query;
+			QueryParser parser;
 
 			cout << "Searching..." << endl << endl;
 
-			perform_search(final_matches, user_query, temp, word_tree, author_table);
+			if (!parser.parse(user_query, query)) {
+				cout << "Invalid query: " << parser.get_error() << "." << endl << endl;
+			}
+			else {
+				parser.prepare(query, stop_words, stem_cache);
+
+				// OR queries of search terms are ranked while they are searched, skipping the documents that can't make the top 15
+				const QueryNode* disjunction = nullptr;
+				vector<const QueryNode*> filters;
+				if (is_or_query(query, disjunction, filters)) {
+					rank_or_query(*disjunction, filters, index, doc_table, bm25, 15, top15_results);
+				}
+				else {
+					perform_search(final_matches, query, index);
 
-			rank_results(final_matches, articles, temp, top15_results);	
+					vector<string> search_terms;
+					query.get_search_terms(search_terms);
+					rank_results(final_matches, index, doc_table, search_terms, bm25, 15, top15_results);	
+				}
+			}
 
-			display_results(top15_results, articles, published_date_map, publication_map); 
+			display_results(top15_results, articles, doc_store, doc_table, published_date_map, publication_map); 
 		}
 
 		// Clear index
 		else if (user_choice == '2') {
 			word_tree.clear_tree();
 			author_table.clear_table();
+			index.clear();
 			cout << "Word index cleared" << endl;
 			cout << "Author index cleared" << endl << endl;
 			num_articles_indexed = 0, num_words_indexed = 0, num_stop_words = 0;
 
  		}
 
- 		// Open index file
+ 		// Open index file, the binary index is printed in the layout of the old word_index.txt
 		else if (user_choice == '3') {
-			ifstream index_ifs("word_index.txt");
-			if (!index_ifs.is_open()) {
-				cout << "Couldn't open file.." << endl;
+			IndexFile dump_file;
+			if (dump_file.open("index.bin")) {
+				dump_file.dump(cout);
+				cout << endl;
 			}
-			string line;
-			while(!index_ifs.eof()) {
-				getline(index_ifs, line);
-				cout << line << endl;
+			else {
+				ifstream index_ifs("word_index.txt");
+				if (!index_ifs.is_open()) {
+					cout << "Couldn't open file.." << endl;
+				}
+				string line;
+				while(!index_ifs.eof()) {
+					getline(index_ifs, line);
+					cout << line << endl;
+				}
+				index_ifs.close();
 			}
-			index_ifs.close();
 		}
 
-		// Restore the index and rebuild the AVLTree and HashTable by reading from the index file 
+		// Restore the index and rebuild the AVLTree and HashTable from the index file. The binary index is mapped and its posting 
+		// lists are only read when they are searched, the segments of the documents added since are reopened the same way.
+		// Text indexes written by older versions are still read line by line
 		else if (user_choice == '4') {
 			cout << "Restoring the index..." << endl;
-			restore_word_index(word_tree);
-			restore_author_index(author_table);
+			word_tree.clear_tree();
+			author_table.clear_table();
+			index.clear();
+
+			if (index_file.open("index.bin")) {
+				index_file.load(word_tree, author_table, doc_table);
+				index.restore(doc_table);
+			}
+			else {
+				restore_word_index(word_tree, doc_table, num_threads);
+				restore_author_index(author_table, doc_table, num_threads);
+			}
 		}
 
 		else if (user_choice == '5') {
-			display_statistics(num_articles_indexed, num_words_indexed, num_stop_words, word_tree, author_table); 
+			display_statistics(num_articles_indexed, num_words_indexed, num_stop_words, word_tree, author_table, index, stem_cache); 
+		}
+
+		else if (user_choice == '6') {
+			run_benchmarks(word_tree, doc_table, bm25, index.get_live_docs());
+		}
+
+		// Delete retracted articles, they stop showing up in the results right away
+		else if (user_choice == '8') {
+			cout << "Please enter the paper ids to delete separated by spaces, or compact to remove the deleted articles from the index files: ";
+			cin.ignore();
+			string paper_ids;
+			getline(cin, paper_ids);
+			cout << endl;
+
+			if (paper_ids == "compact") {
+				compact_index(index, doc_table);
+			}
+			else {
+				delete_documents(paper_ids, index, doc_table);
+			}
+		}
+
+		// Index new json files without reprocessing the articles that are already indexed
+		else if (user_choice == '7') {
+			cout << "Please enter a directory, or the paths of the json files separated by spaces: ";
+			cin.ignore();
+			string source;
+			getline(cin, source);
+			cout << endl;
+
+			add_documents(source, index, articles, doc_store, doc_table,
+				num_articles_indexed, num_words_indexed, num_stop_words, num_threads, stop_words, stem_cache);
 		}
 
 		else if (user_choice == '9') {
+			// Let a merge that is running finish writing its segment
+			index.close();
 			exit(1);
 		}
 
@@ -184,6 +337,9 @@ void display_menu() {
 	cout << " 3. open a persistence file" << endl;
 	cout << " 4. parse the corpus and populate index" << endl;
 	cout << " 5. print basic statistics of the search engine" << endl;
+	cout << " 6. run the performance benchmarks" << endl;
+	cout << " 7. add documents to the index" << endl;
+	cout << " 8. delete articles from the index" << endl;
 	cout << " 9. quit" << endl;
 }
 
@@ -191,105 +347,443 @@ void display_menu() {
 // The Index processor
 // This function is responsible for building Article objects, and inverted file index using data structures such as AVLTree for 
 // storing unique words and HashTable for storing unique authors by parsing the dataset (json files)
-void index_processor(AVLTree& word_tree, HashTable& author_table, vector<Article>& articles, 
-	unordered_map<string, string>& published_date_map, unordered_map<string, string>& publication_map,
-	int& num_articles_indexed, int& num_words_indexed, int& num_stop_words) {
+// The json files are streamed through in small windows: every file in a window is parsed, analyzed and indexed, then its body text 
+// is moved to the document store and released, so only the texts of one window are in memory at a time
+// With more than one thread, each window is split into contiguous partitions, each worker indexes its partition into a private 
+// AVLTree and HashTable, and the partial indexes are merged in partition order, so the index is the same as the sequential one
+void index_processor(AVLTree& word_tree, HashTable& author_table, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
+	int& num_articles_indexed, int& num_words_indexed, int& num_stop_words, int num_threads, StopWordSet& stop_words, StemCache& stem_cache) {
 
-	// Parse the metadata.csv, and create two maps, one maps "paper_id" to "published date", the other maps "paper_id" to "publication"
-	parse_csv("../dataset_small/metadata-cs2341.csv", published_date_map, publication_map);
+	// Find all the .json files in the cs2341_data folder, they are only parsed when their window is indexed
+	vector<string> file_paths;
+	parse_directory("../dataset_small", file_paths);
+
+	index_files(file_paths, word_tree, author_table, articles, doc_store, doc_table, 
+		num_articles_indexed, num_words_indexed, num_stop_words, num_threads, stop_words, stem_cache);
+
+
+	// Compress the document ids of every word now that all of them are in
+	word_tree.seal();
+
+	// Writing the word index, the author index and the document ids to the binary index file
+	if (!IndexFile::write("index.bin", word_tree, author_table, doc_table)) {
+		cout << "Couldn't write index.bin.." << endl;
+	}
+
+}
+
+
+// Parses and indexes the json files in file_paths into the given AVLTree and HashTable. The articles get the next document ids
+// of the DocumentTable, in the order of their files, and are appended to the articles and the document store. A file that can't
+// be parsed is left out and gets no document id
+void index_files(vector<string>& file_paths, AVLTree& word_tree, HashTable& author_table, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
+	int& num_articles_indexed, int& num_words_indexed, int& num_stop_words, int num_threads, StopWordSet& stop_words, StemCache& stem_cache) {
+
+	if (num_threads < 1) {
+		num_threads = 1;
+	}
+
+	// The number of articles in flight at once, enough to keep every worker busy 
+	int window_size = 32 * num_threads;
+
+	// The partial indexes are reused by every window
+	vector<AVLTree> partial_trees(num_threads > 1 ? num_threads : 0);
+	vector<HashTable> partial_tables(num_threads > 1 ? num_threads : 0, HashTable(author_table.get_size()));
+
+	for (int window_begin = 0; window_begin < file_paths.size(); window_begin += window_size) {
+
+		int window_end = min((int) file_paths.size(), window_begin + window_size);
+		vector<string> window_paths(file_paths.begin() + window_begin, file_paths.begin() + window_end);
+		vector<Article> batch(window_paths.size());
+		// Whether each file of the window could be parsed (char, so the threads can set their own elements)
+		vector<char> parsed(window_paths.size(), 0);
+
+		// The files of the window are parsed first, so the ones that fail can be left out before the document ids are given
+		if (num_threads == 1) {
+			parse_partition(window_paths, batch, parsed, 0, batch.size());
+		}
+		else {
+			vector<thread> parsers;
+			int partition_size = (batch.size() + num_threads - 1) / num_threads;
+			for (int t = 0; t < num_threads; t += 1) {
+				int begin = min((int) batch.size(), t * partition_size);
+				int end = min((int) batch.size(), begin + partition_size);
+				parsers.push_back(thread(parse_partition, ref(window_paths), ref(batch), ref(parsed), begin, end));
+			}
+			for (int t = 0; t < num_threads; t += 1) {
+				parsers.at(t).join();
+			}
+		}
+
+		int num_parsed = 0;
+		for (int i = 0; i < batch.size(); i += 1) {
+			if (parsed.at(i)) {
+				if (num_parsed != i) {
+					batch.at(num_parsed) = move(batch.at(i));
+				}
+				num_parsed += 1;
+			}
+		}
+		batch.resize(num_parsed);
+
+		// The number of words of each article of the window without the stop words, the number of words indexed (each word once)
+		// and the number of stop words
+		vector<uint32_t> lengths(batch.size());
+		vector<uint32_t> word_counts(batch.size());
+		vector<uint32_t> stop_word_counts(batch.size());
+
+		// The articles of the window get the next document ids, in the order of their files
+		DocId first_doc = doc_table.size();
+
+		if (num_threads == 1) {
+			index_partition(batch, 0, batch.size(), first_doc, stop_words, stem_cache, word_tree, author_table, lengths, word_counts, stop_word_counts);
+		}
+		else {
+			vector<thread> workers;
+
+			int partition_size = (batch.size() + num_threads - 1) / num_threads;
+
+			for (int t = 0; t < num_threads; t += 1) {
+				int begin = min((int) batch.size(), t * partition_size);
+				int end = min((int) batch.size(), begin + partition_size);
+
+				workers.push_back(thread(index_partition, ref(batch), begin, end, first_doc, ref(stop_words), ref(stem_cache), 
+					ref(partial_trees.at(t)), ref(partial_tables.at(t)), ref(lengths), ref(word_counts), ref(stop_word_counts)));
+			}
+
+			// Merge the partial indexes in the same order as their partitions, so every id_list stays sorted by document id
+			for (int t = 0; t < num_threads; t += 1) {
+				workers.at(t).join();
+
+				word_tree.merge(partial_trees.at(t));
+				author_table.merge(partial_tables.at(t));
 
-	// Parse all the .json files in the cs2341_data folder to build a vector of Article objects
-	parse_directory("../dataset_small", articles);
+				partial_trees.at(t).clear_tree();
+				partial_tables.at(t).clear_table();
+			}
+		}
+
+		// Move the body texts of the window to the document store, and keep only the metadata in memory
+		for (int i = 0; i < batch.size(); i += 1) {
+			doc_table.add(batch.at(i).get_id(), lengths.at(i));
+			doc_store.add(batch.at(i), word_counts.at(i), stop_word_counts.at(i));
+			batch.at(i).release_text();
+			articles.push_back(batch.at(i));
+			num_words_indexed += word_counts.at(i);
+			num_stop_words += stop_word_counts.at(i);
+		}
+
+		num_articles_indexed += batch.size();
+	}
+}
 
 
-	int num_article_parsed = articles.size();
+// This function parses the json files in [begin, end) of file_paths into the same positions of batch, parsed[i] is set if the
+// file i could be parsed. It is called once per window when indexing sequentially, or once per partition by each worker thread
+void parse_partition(vector<string>& file_paths, vector<Article>& batch, vector<char>& parsed, int begin, int end) {
+	for (int i = begin; i < end; i += 1) {
+		parsed.at(i) = parse_json(file_paths.at(i), batch.at(i));
+	}
+}
 
 
+// This function indexes the articles in [begin, end) of batch into the given AVLTree and HashTable. The article at position i
+// of batch has the document id first_doc + i, its length goes to lengths[i], its number of words indexed to word_counts[i] and
+// its number of stop words to stop_word_counts[i]
+// It is called once per window when indexing sequentially, or once per partition by each worker thread
+void index_partition(vector<Article>& batch, int begin, int end, DocId first_doc, StopWordSet& stop_words, StemCache& stem_cache,
+	AVLTree& word_tree, HashTable& author_table, vector<uint32_t>& lengths, vector<uint32_t>& word_counts, vector<uint32_t>& stop_word_counts) {
 
 	// Retrieve information from the Articles objects for each node to build the AVLTree and the HashTable
-	//  - paper_id 
-	//  - text =>  1.remove punctuations  2.lowercase  3.tokenize  4.remove stop words  5.stem  6. remove duplicates 
-	string paper_id;
+	//  - document id 
+	//  - text =>  1.remove punctuations, lowercase and tokenize in one pass  2.remove stop words  3.stem  4. remove duplicates, 
+	//             counting how many times each word appeared and where (its positions are the token offsets, counting the stop
+	//             words, so a phrase matches when its words are at consecutive positions)
+	DocId doc;
 	string text;
-	vector<string> tokens;  // tokens of text
 	vector<string> authors_last;
 
-
-	// Inserting stop words into an AVLTree
-	AVLTree stop_words_tree;
-	load_stop_words(stop_words_tree);
+	TextNormalizer normalizer;
 
 	// Iterate over each article
-	for (int i = 0; i < articles.size(); i += 1) {
+	for (int i = begin; i < end; i += 1) {
 
-		paper_id = articles.at(i).get_id();
-		text = articles.at(i).get_text();
-		authors_last = articles.at(i).get_authors_last();
+		doc = first_doc + i;
+		text = batch.at(i).get_text();
+		authors_last = batch.at(i).get_authors_last();
 
 
 		// The whole text processing happens here
-		remove_punctuation(text);
-
-		to_lower(text);
-
-		// tokenize the body text
-		tokens = tokenize(text);
+		vector<TokenView>& tokens = normalizer.normalize(text);
 
 		// stop words removal
 		vector<string> temp;  // A vector that stores words that are not stop words 
+		vector<uint32_t> positions;  // The position of each of them in the text
+		uint32_t num_stop_words = 0;
 		for (int i = 0; i < tokens.size(); i += 1) {
-			if (stop_words_tree.contain(tokens.at(i))) {
+			string_view token(text.data() + tokens.at(i).offset, tokens.at(i).length);
+			if (stop_words.contains(token)) {
 				num_stop_words += 1;
 			}
 			else {
-				temp.push_back(tokens.at(i));
+				temp.push_back(string(token));
+				positions.push_back(i);
 			}
 		}
 
-		stem_words(temp);
+		lengths.at(i) = temp.size();
+		stop_word_counts.at(i) = num_stop_words;
 
-		remove_duplicates(temp);
+		stem_words(temp, stem_cache);
+
+		vector<uint32_t> counts;
+		remove_duplicates(temp, positions, counts);
 		
-		// Inserting words for one article into the AVLTree
+		// Inserting words for one article into the AVLTree, with their term frequencies and positions
+		int first_position = 0;
 		for (int j = 0; j < temp.size(); j += 1) {
-	        word_tree.insert(temp.at(j), paper_id); 
-	        num_words_indexed += 1;
+	        word_tree.insert(temp.at(j), doc, counts.at(j), positions.data() + first_position); 
+	        first_position += counts.at(j);
 		}
+		word_counts.at(i) = temp.size();
 
 
 		// Inserting authors for one article into the HashTable
 		for (int j = 0; j < authors_last.size(); j += 1) {
-			author_table.insert(authors_last.at(j), paper_id);
+			author_table.insert(authors_last.at(j), doc);
 		}
+	}
+}
+
+
 
-		num_articles_indexed += 1;
+// Deletes the articles with the given paper ids (separated by spaces) from the index
+void delete_documents(string paper_ids, SegmentedIndex& index, DocumentTable& doc_table) {
+
+	istringstream paper_ids_iss(paper_ids);
+	string paper_id;
+	while (paper_ids_iss >> paper_id) {
+		if (index.delete_document(paper_id, doc_table)) {
+			cout << "Deleted " << paper_id << endl;
+		}
+		else {
+			cout << paper_id << " is not in the index." << endl;
+		}
 	}
+}
+
 
+// Removes the deleted articles from the index files: the base is written again to index.bin without them, and so are the 
+// segments that hold some
+void compact_index(SegmentedIndex& index, DocumentTable& doc_table) {
 
-	// Writing word_index to a text file
-	ofstream word_index_ofs("word_index.txt");
-	word_tree.write_to_file(word_index_ofs);
-	word_index_ofs.close();
+	AVLTree& word_tree = index.get_base_words();
+	HashTable& author_table = index.get_base_authors();
 
-	// Writing author_index to a text file
-	ofstream author_index_ofs("author_index.txt");
-	author_table.write_to_file(author_index_ofs);
-	author_index_ofs.close();
+	// Writing a cleared index would lose index.bin
+	if (word_tree.get_num_unique_words() == 0) {
+		cout << "The index is empty, restore it before compacting it." << endl;
+		return;
+	}
+
+	word_tree.remove_docs(index.get_live_docs());
+	author_table.remove_docs(index.get_live_docs());
+	if (!IndexFile::write("index.bin", word_tree, author_table, doc_table)) {
+		cout << "Couldn't write index.bin.." << endl;
+	}
 
+	index.compact(doc_table);
+	cout << "Index compacted" << endl;
+}
+
+
+// Adds the json files in a list of paths separated by spaces, which can be files or directories, to the index. CORD-19 names every
+// json file after its paper_id, so the files of the articles that are already indexed are skipped without being parsed.
+// The new articles are indexed into the buffer of the index, which is flushed to a new segment every BUFFER_DOCS articles and
+// at the end, so they can be searched right away without touching the rest of the index. Their document ids come after the ones
+// already given
+void add_documents(string source, SegmentedIndex& index, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
+	int& num_articles_indexed, int& num_words_indexed, int& num_stop_words, int num_threads, StopWordSet& stop_words, StemCache& stem_cache) {
+
+	vector<string> file_paths;
+	struct stat filestat;
+	istringstream source_iss(source);
+	string file_path;
+	while (source_iss >> file_path) {
+		if (stat(file_path.c_str(), &filestat) == 0 && S_ISDIR(filestat.st_mode)) {
+			parse_directory(file_path, file_paths);
+		}
+		else {
+			file_paths.push_back(file_path);
+		}
+	}
+
+	vector<string> new_paths;
+	unordered_map<string, bool> seen;
+	DocId doc;
+	for (int i = 0; i < file_paths.size(); i += 1) {
+		string paper_id = get_file_paper_id(file_paths.at(i));
+
+		// A deleted paper can be added again, it gets a new document id
+		if ((doc_table.find(paper_id, doc) && index.get_live_docs().is_live(doc)) || seen[paper_id]) {
+			continue;
+		}
+		if (stat(file_paths.at(i).c_str(), &filestat) != 0) {
+			cout << "Couldn't open " << file_paths.at(i) << endl;
+			continue;
+		}
+		seen[paper_id] = true;
+		new_paths.push_back(file_paths.at(i));
+	}
+
+	if (new_paths.empty()) {
+		cout << "No new articles to add." << endl;
+		return;
+	}
+
+	int num_added = num_articles_indexed;
+	for (int begin = 0; begin < new_paths.size(); begin += SegmentedIndex::BUFFER_DOCS) {
+		int end = min((int) new_paths.size(), begin + SegmentedIndex::BUFFER_DOCS);
+		vector<string> buffer_paths(new_paths.begin() + begin, new_paths.begin() + end);
+
+		DocId first_doc = doc_table.size();
+		Segment& buffer = index.get_buffer();
+		index_files(buffer_paths, buffer.word_tree, buffer.author_table, articles, doc_store, doc_table,
+			num_articles_indexed, num_words_indexed, num_stop_words, num_threads, stop_words, stem_cache);
+		index.flush(doc_table, first_doc);
+	}
+	num_added = num_articles_indexed - num_added;
+
+	// The files that couldn't be parsed aren't in the index, a fixed copy of them can be added later
+	int num_failed = new_paths.size() - num_added;
+	cout << "Added " << num_added << " articles (" << file_paths.size() - num_added << " skipped";
+	if (num_failed > 0) {
+		cout << ", " << num_failed << " of them couldn't be parsed";
+	}
+	cout << ")" << endl;
+}
+
+
+
+// Reopens the segments of the articles added in the previous runs on top of the base rebuilt at startup, and reads the deleted
+// articles back. The metadata and the body texts of the added articles are copied from the document store of the previous run, 
+// which was moved to old_store_path, so their files aren't parsed again. If the dataset doesn't have the same documents as when
+// the segments were written, their document ids don't mean anything any more and they are dropped
+void restore_added_documents(SegmentedIndex& index, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
+	int& num_articles_indexed, int& num_words_indexed, int& num_stop_words, string old_store_path) {
+
+	int base_docs = doc_table.size();
+	index.reopen_documents(doc_table);
+
+	{
+		DocumentStore old_store(old_store_path);
+		for (DocId doc = base_docs; doc < doc_table.size(); doc += 1) {
+			Article article;
+			uint32_t words = 0, stop_words = 0;
+			if (doc < old_store.size()) {
+				article = old_store.get_article(doc);
+			}
+			if (article.get_id() == doc_table.get_paper_id(doc)) {
+				article.get_text_ref() = old_store.get_text(doc);
+				words = old_store.get_num_words(doc);
+				stop_words = old_store.get_num_stop_words(doc);
+			}
+			// An article the old store doesn't have can still be found, but only shows its paper id
+			else {
+				article = Article(doc_table.get_paper_id(doc), "N/A", {"N/A"}, {"N/A"}, "");
+			}
+			doc_store.add(article, words, stop_words);
+			article.release_text();
+			articles.push_back(article);
+			num_words_indexed += words;
+			num_stop_words += stop_words;
+		}
+	}
+	remove(old_store_path.c_str());
+	num_articles_indexed += doc_table.size() - base_docs;
+
+	index.restore(doc_table);
+}
+
+
+// Opens the index of the previous run instead of indexing the dataset again: the base from index.bin, the segments of the
+// articles added since and the deleted articles, with the metadata and the body texts of the articles from the document store.
+// index.bin has to have the json files of the dataset as its documents, in the order they are found, and be newer than all of
+// them and than the stop word list, otherwise it isn't the index the dataset gives any more. A json file that couldn't be parsed
+// isn't in index.bin, so a dataset with one is indexed again at every start. Returns false, with nothing restored, if the index
+// can't be opened or the document store doesn't have all its articles
+bool open_index(SegmentedIndex& index, IndexFile& index_file, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
+	int& num_articles_indexed, int& num_words_indexed, int& num_stop_words) {
+
+	struct stat index_stat, filestat;
+	if (stat("index.bin", &index_stat) != 0 || !index_file.open("index.bin")) {
+		return false;
+	}
+
+	vector<string> file_paths;
+	parse_directory("../dataset_small", file_paths);
+	vector<uint32_t> lengths;
+	vector<string> paper_ids = index_file.get_paper_ids(lengths);
+	bool same_dataset = paper_ids.size() == file_paths.size();
+	for (int i = 0; i < file_paths.size() && same_dataset; i += 1) {
+		same_dataset = get_file_paper_id(file_paths.at(i)) == paper_ids.at(i) && stat(file_paths.at(i).c_str(), &filestat) == 0 &&
+			filestat.st_mtime <= index_stat.st_mtime;
+	}
+	if (stat("stop-words-list.txt", &filestat) == 0 && filestat.st_mtime > index_stat.st_mtime) {
+		same_dataset = false;
+	}
+	if (!same_dataset) {
+		index_file.close();
+		return false;
+	}
+
+	// The documents of index.bin, then the ones of the segments
+	for (int i = 0; i < paper_ids.size(); i += 1) {
+		doc_table.add(paper_ids.at(i), lengths.at(i));
+	}
+	index.reopen_documents(doc_table);
+
+	bool same_store = doc_store.size() >= doc_table.size();
+	for (DocId doc = 0; doc < doc_table.size() && same_store; doc += 1) {
+		articles.push_back(doc_store.get_article(doc));
+		same_store = articles.back().get_id() == doc_table.get_paper_id(doc);
+	}
+	if (!same_store) {
+		articles.clear();
+		doc_table.clear();
+		index_file.close();
+		return false;
+	}
+	// The articles added to the store after the last segment was written were never searchable
+	doc_store.resize(doc_table.size());
+
+	index_file.load(index.get_base_words(), index.get_base_authors(), doc_table);
+	index.restore(doc_table);
+
+	num_articles_indexed = doc_table.size();
+	for (DocId doc = 0; doc < doc_table.size(); doc += 1) {
+		num_words_indexed += doc_store.get_num_words(doc);
+		num_stop_words += doc_store.get_num_stop_words(doc);
+	}
+	return true;
 }
 
 
 
 // The Document processor
 // This function parses the metadata.csv and creates two maps, one maps "paper_id" to "published date", the other maps "paper_id" to "publication"
+// The csv is memory mapped and the parser reads its rows from the mapped bytes through a stream
 void parse_csv(string file_path, unordered_map<string, string>& published_date_map, unordered_map<string, string>& publication_map) {
 	
-	ifstream csv_inFS(file_path);  	 
-	if (!csv_inFS.is_open()) {
+	MappedFile csv_file(file_path);
+	if (!csv_file.is_open()) {
 		cout << "couldn't open the .csv file..." << endl;
+		return;
 	}
 
-	CsvParser parser(csv_inFS);
+	MappedStreamBuf csv_buf(csv_file.begin(), csv_file.end());
+	istream csv_is(&csv_buf);
+	CsvParser parser(csv_is);
 
 	// Each row of the CSV is represented as a vector<string>
 	for (auto& row : parser) {
@@ -304,16 +798,12 @@ void parse_csv(string file_path, unordered_map<string, string>& published_date_m
 
 
 // The Document processor
-// This function parse every json file in the "cs2341_data" folder, and return a vector of Article objects 
+// This function finds every json file in the "cs2341_data" folder, and returns their paths in directory order so the 
+// index processor can parse them one window at a time
 // (11995 json files + 1 the first file is alwasy .DS_Store file + 1 csv file)
-void parse_directory(string folder_path, vector<Article>& articles) {
-    
-  Article article;
-
-  int filepath_count = 0;
+void parse_directory(string folder_path, vector<string>& file_paths) {
 
   string dir, filepath;
-  int num = 1;
   DIR *dp;
   struct dirent *dirp;
   struct stat filestat;
@@ -325,12 +815,9 @@ void parse_directory(string folder_path, vector<Article>& articles) {
 
   if (dp == NULL) {
     cout << "Error(" << errno << ") opening " << dir << endl;
+    return;
   }
 
-
-  // To limit the numner of files to pares
-  int counter = 0;
-
   while ((dirp = readdir( dp ))) {
     filepath = dir + "/" + dirp->d_name;
 
@@ -339,13 +826,9 @@ void parse_directory(string folder_path, vector<Article>& articles) {
     if (S_ISDIR( filestat.st_mode ))         continue;
 
 
-    // Where we acutually open the json files and do stuff 
+    // Only keep the json files 
     if (filepath[filepath.size() - 1] == 'n') {
-
-      // parsing magic goes here...
-      article = parse_json(filepath);
-      articles.push_back(article);
-
+      file_paths.push_back(filepath);
     }
   }
 
@@ -353,9 +836,47 @@ void parse_directory(string folder_path, vector<Article>& articles) {
 }
 
 
+// CORD-19 names every json file after the paper_id of its article
+string get_file_paper_id(const string& file_path) {
+	string paper_id = file_path.substr(file_path.find_last_of('/') + 1);
+	if (paper_id.size() > 5 && paper_id.substr(paper_id.size() - 5) == ".json") {
+		paper_id.erase(paper_id.size() - 5);
+	}
+	return paper_id;
+}
+
+
+// The Document porcessor
+// This function parses one json file into an Article object. Returns false if the file couldn't be opened or isn't valid json
+// Only the fields we index are extracted by a SAX handler, every worker thread keeps its own JsonExtractor so its buffers 
+// are reused from one file to the next. The handler reads the file straight from its mapped (or read) bytes
+bool parse_json(string& file_path, Article& article) {
+
+	static thread_local JsonExtractor extractor;
+
+	bool parsed = false;
+	MappedFile json_file(file_path);
+	if (!json_file.is_open()) {
+		// Otherwise the extractor still holds the article of the previous file
+		extractor.reset();
+		cout << "couldn't open " << file_path << endl;
+	}
+	else if (!extractor.extract(json_file.begin(), json_file.end())) {
+		cout << "couldn't parse " << file_path << endl;
+	}
+	else {
+		parsed = true;
+	}
+
+	article = extractor.get_article();
+	return parsed;
+}
+
+
 // The Document porcessor
-// This function parses one json file, creates an Article object out of it and returns it
-Article parse_json(string& file_path) {
+// This function parses one json file into a whole json object and builds the Article from it.
+// It is kept to compare against parse_json in the benchmarks
+Article parse_json_dom(string& file_path) {
   
 	ifstream json_ifs(file_path);
 
@@ -456,41 +977,66 @@ vector<string> tokenize(string& str) {
 }
 
 
-void load_stop_words(AVLTree& stop_words_tree) {
+// The stop words are compiled into the program from stop-words-list.txt (see StopWordList.h). If they weren't, or the file
+// was edited since StopWordList.h was generated from it, the perfect hash table is built from the file instead
+void load_stop_words(StopWordSet& stop_words) {
 
-	ifstream stop_word_list_inFS("stop-words-list.txt");
-    string stop_word;
+	if (StopWordSet::is_compiled()) {
+		if (stop_words.same_words("stop-words-list.txt")) {
+			return;
+		}
+		cout << "stop-words-list.txt doesn't match the compiled stop words, regenerate StopWordList.h (see its header). "
+			<< "Using the file for now." << endl;
+	}
 
-    while (!stop_word_list_inFS.eof()) {
-    	getline(stop_word_list_inFS, stop_word);
-	    stop_words_tree.insert(stop_word);
+	if (!stop_words.load("stop-words-list.txt")) {
+		cout << "Couldn't open stop-words-list.txt.." << endl;
 	}
-	stop_word_list_inFS.close();
 }
 
 
 
-// This functions uses the C++ porter2_stemmer to stem words 
-void stem_words(vector<string>& tokens) {
+// This functions uses the C++ porter2_stemmer to stem words, through the stem cache so every unique word is only stemmed once
+void stem_words(vector<string>& tokens, StemCache& stem_cache) {
 
 	for (int i = 0; i < tokens.size(); i += 1) {
-		Porter2Stemmer::trim(tokens.at(i));
-        Porter2Stemmer::stem(tokens.at(i));
+		stem_cache.stem(tokens.at(i));
 	}
 }
 
 
-// unique() removes all consecutive duplicate elements
-// constant space, nlog(n) run time
-// reference: https://www.techiedelight.com/remove-duplicates-vector-cpp/
-void remove_duplicates(vector<string>& tokens) {
+// Sorting puts the duplicates next to each other, so every run of the same token is kept once and its length is pushed to counts
+// positions holds the position of every token, they are reordered so the positions of each kept token follow each other, in 
+// increasing order. nlog(n) run time
+void remove_duplicates(vector<string>& tokens, vector<uint32_t>& positions, vector<uint32_t>& counts) {
 
-	sort(tokens.begin(), tokens.end());
-	tokens.erase( unique(tokens.begin(), tokens.end()) , tokens.end());
+	// The tokens are sorted through their indexes, a stable sort keeps the positions of the same token in increasing order
+	vector<int> order(tokens.size());
+	for (int i = 0; i < order.size(); i += 1) {
+		order.at(i) = i;
+	}
+	stable_sort(order.begin(), order.end(), [&tokens](int a, int b) { return tokens.at(a) < tokens.at(b); });
+
+	vector<string> kept_tokens;
+	vector<uint32_t> sorted_positions;
+	for (int i = 0; i < order.size(); i += 1) {
+		string& token = tokens.at(order.at(i));
+		if (!kept_tokens.empty() && token == kept_tokens.back()) {
+			counts.back() += 1;
+		}
+		else {
+			kept_tokens.push_back(token);
+			counts.push_back(1);
+		}
+		sorted_positions.push_back(positions.at(order.at(i)));
+	}
+	tokens = kept_tokens;
+	positions = sorted_positions;
 }
 
 
-void display_statistics(int num_articles_indexed, int num_words_indexed, int num_stop_words, AVLTree& word_tree, HashTable& author_table) {
+// The word and author counts are the ones of the base segment, the index of the dataset
+void display_statistics(int num_articles_indexed, int num_words_indexed, int num_stop_words, AVLTree& word_tree, HashTable& author_table, SegmentedIndex& index, StemCache& stem_cache) {
 
 	cout << "Total number of articles indexed:            " << num_articles_indexed << endl;
 	cout << "Total numer of words indexed:                " << num_words_indexed << endl;
@@ -505,10 +1051,25 @@ void display_statistics(int num_articles_indexed, int num_words_indexed, int num
 	cout << "Average number of stop words in per article: " << 0 << endl;
  	}
 
-	cout << endl << "Top 50 most frequent words => " << endl;
+	cout << "Stem cache hit rate:                         " << stem_cache.get_hit_rate() * 100 << "% (" << stem_cache.get_hits() << " hits, " 
+		<< stem_cache.get_misses() << " misses, " << stem_cache.size() << " words cached)" << endl;
+
 	// Traverse the AVLTree and store all nodes in a vector, and sort the vector by the node's data member count
 	vector<Node*> words;
 	words = word_tree.get_words();
+
+	// The memory the posting lists would take as one vector of document ids per word
+	long long vector_bytes = 0;
+	for (int i = 0; i < words.size(); i += 1) {
+		vector_bytes += sizeof(vector<DocId>) + words.at(i)->count * sizeof(DocId);
+	}
+	// The postings also hold the term frequencies and the positions, only their ids compare with the vectors
+	cout << "Word index postings:                         " << word_tree.get_postings_memory() / 1024 << " KB, the document ids take " 
+		<< word_tree.get_doc_ids_memory() / 1024 << " KB compressed (" << vector_bytes / 1024 << " KB as vectors of document ids)" << endl;
+	cout << "Segments of added articles:                  " << index.get_num_segments() << " (" << index.get_num_segment_docs() << " articles)" << endl;
+	cout << "Deleted articles:                            " << index.get_live_docs().get_num_deleted() << endl;
+
+	cout << endl << "Top 50 most frequent words => " << endl;
 	sort(words.begin(), words.end(), way_to_sort);
 
 	for (int i = 0; i < words.size(); i += 1) {
@@ -527,256 +1088,262 @@ bool way_to_sort(Node*& lhs, Node*& rhs) {
 }
 
 
-// reference: https://stackoverflow.com/questions/25505868/the-intersection-of-multiple-sorted-arrays
-vector<string> intersection(vector<vector<string>>& vecs) {
-
-    auto last_intersection = vecs[0];
-    vector<string> curr_intersection;
-
-    for (int i = 1; i < vecs.size(); ++i) {
-        set_intersection(last_intersection.begin(), last_intersection.end(),
-            vecs[i].begin(), vecs[i].end(),
-            back_inserter(curr_intersection));
-        swap(last_intersection, curr_intersection);
-        curr_intersection.clear();
-    }
-    return last_intersection;
-}
+// The Query processor and Search processor. 
+// The query was parsed into its operator tree (see QueryParser.h), with its words stemmed the same way as the words in the
+// index. Each segment of the index is searched on its own by a QueryPlanner (see QueryPlanner.h), which starts every AND from
+// its cheapest operand. The segments hold increasing ranges of document ids, so their matches are appended in order
+void perform_search(vector<DocId>& final_matches, QueryNode& query, SegmentedIndex& index) {
 
+	vector<shared_ptr<Segment>> segments = index.snapshot();
+	report_missing_terms(query, segments);
 
-vector<string> get_union(vector<string> v) {
-	remove_duplicates(v);
-	return v;
+	for (int s = 0; s < segments.size(); s += 1) {
+		QueryPlanner planner(*segments.at(s), index.get_live_docs());
+		planner.evaluate(query, final_matches);
+	}
 }
 
 
-// The Query processor and Search processor. 
-// This function parses the prefix boolean query enterd by the user and find the final matches of paper ids.
-void perform_search(vector<string>& final_matches, string user_query, string& temp, AVLTree& word_tree, HashTable& author_table) {
-
-	vector<string> possible_matches; // stores final possible matches for either AND or OR (either intersection or union) 
-	vector<string> exclusions;       // stores the paper ids of the search term followed by NOT
-	vector<string> authors_matches;	 // stores the paper ids of the search term followed by AUTHOR
-
+// Tells the user about the search terms and the authors of the query that aren't in any segment of the index
+void report_missing_terms(const QueryNode& node, vector<shared_ptr<Segment>>& segments) {
 
-	// If an AND operator is in the query, extract the search terms, get their paper ids, and find the intersection of them
-	// AND could be followed by a NOT or AUTHOR
-	if (user_query.find("AND") != string::npos) {       
-		
-		vector<vector<string>> vecs;     // stores vectors of ids of the search terms followed by AND
-
-		for (int i = 4; i < user_query.size(); i += 1) {
-			if (user_query[i] == 'N' | user_query[i] == 'A') {
-				break;
+	if (node.type == QueryNode::TERM || node.type == QueryNode::PHRASE) {
+		vector<string> words = node.words;
+		if (node.type == QueryNode::TERM) {
+			words.push_back(node.text);
+		}
+		bool all_found = !words.empty();
+		bool has_positions = true;
+		for (int i = 0; i < words.size(); i += 1) {
+			bool found = false;
+			for (int s = 0; s < segments.size(); s += 1) {
+				const PostingList* postings = segments.at(s)->word_tree.get_postings(words.at(i));
+				if (postings != nullptr) {
+					found = true;
+					has_positions = has_positions && postings->has_positions();
+				}
 			}
-			temp += user_query[i];
+			all_found = all_found && found;
 		}
-	
-		vector<string> search_terms = tokenize(temp);
 
-		// Get the vector of paper_ids for each search term from the index, store them in vecs 
-		for (int i = 0; i < search_terms.size(); i += 1) {
-			vector<string> id_list;
-			word_tree.get_paper_ids(search_terms.at(i), id_list);
-			sort(id_list.begin(), id_list.end());  // intersection fucntion only works for sorted arrays 
-			vecs.push_back(id_list);
+		if (!all_found) {
+			cout << "search term not found." << endl << endl;
+		}
+		// The index restored from the old text index doesn't have positions
+		else if (node.type == QueryNode::PHRASE && words.size() > 1 && !has_positions) {
+			cout << "phrase search needs the positions of the words, rebuild the index to search for phrases." << endl << endl;
 		}
-
-		possible_matches = intersection(vecs);
-		
 	}
 
-	// If an OR operator is in the query, extract the search terms, get their paper ids, and find the union of them
-	// OR could be followed by a NOT or AUTHOR. Make sure the fins() doesn't mistake the OR in AUTHOR for OR
-	if (user_query.find("OR") == 0) {
-
-		vector<string> temp_union; 		 // stores all paper ids of the search terms followed by OR
-
-		for (int i = 3; i < user_query.size(); i += 1) {
-			if (user_query[i] == 'N' | user_query[i] == 'A') {
-				break;
-			}
-			temp += user_query[i];
+	else if (node.type == QueryNode::AUTHOR) {
+		vector<DocId> doc_ids;
+		bool found = false;
+		for (int s = 0; s < segments.size(); s += 1) {
+			found = segments.at(s)->author_table.get_doc_ids(node.text, doc_ids) || found;
 		}
-
-		vector<string> search_terms = tokenize(temp);
-
-		// Get the all paper_ids for each search term from the index, store them in temp_union 
-		for (int i = 0; i < search_terms.size(); i += 1) {
-			vector<string> id_list;
-			word_tree.get_paper_ids(search_terms.at(i), id_list);
-
-			// Insert all the paper ids into one vector of string and remove duplicates to find the union the paper ids
-			temp_union.insert(temp_union.end(), id_list.begin(), id_list.end());
+		if (!found) {
+			cout << "author not found..." << endl;
 		}
-		// removing duplicates to make it a union
-		remove_duplicates(temp_union); 
-		possible_matches = temp_union;
-
 	}
 
-	// There is no AND or OR operator in the query, the one search term could be followed by a NOT or AUTHOR
-	if (possible_matches.empty()) {
+	for (int i = 0; i < node.children.size(); i += 1) {
+		report_missing_terms(node.children.at(i), segments);
+	}
+}
 
-		for (int i = 0; i < user_query.size(); i += 1) {
-			if (user_query[i] == ' ') {
-				break;
-			}
-			temp += user_query[i];
-		}
 
-		word_tree.get_paper_ids(temp, possible_matches);
+// Whether the query is an OR of search terms, only filtered by NOT and AUTHOR. If it is, disjunction is set to the OR and
+// filters to the NOT and AUTHOR nodes
+bool is_or_query(const QueryNode& query, const QueryNode*& disjunction, vector<const QueryNode*>& filters) {
 
+	disjunction = nullptr;
+	filters.clear();
+	if (query.type == QueryNode::OR) {
+		disjunction = &query;
 	}
-
-	// NOT could be followed by a AUTHOR.
-	if (user_query.find("NOT") != string::npos) {     
-		int NOT_pos = user_query.find("NOT");
-		string not_term = "";
-		for (int i = NOT_pos + 4; i < user_query.size(); i += 1) {
-			if (user_query[i] == ' ') {  // Only one search term, so break if it his a white space
-				break;
+	else if (query.type == QueryNode::AND) {
+		for (int i = 0; i < query.children.size(); i += 1) {
+			const QueryNode& child = query.children.at(i);
+			if (child.type == QueryNode::NOT || child.type == QueryNode::AUTHOR) {
+				filters.push_back(&child);
+			}
+			else if (child.type == QueryNode::OR && disjunction == nullptr) {
+				disjunction = &child;
+			}
+			else {
+				return false;
 			}
-			not_term += user_query[i];
 		}
-
-		word_tree.get_paper_ids(not_term, exclusions);
+	}
+	if (disjunction == nullptr) {
+		return false;
 	}
 
-	// AUTHOR could only be followed by a last name
-	if (user_query.find("AUTHOR") != string::npos) {  
-		int AUTHOR_pos = user_query.find("AUTHOR");
-		string author_term = "";
-		for (int i = AUTHOR_pos + 7; i < user_query.size(); i += 1) {
-			author_term += user_query[i];
+	for (int i = 0; i < disjunction->children.size(); i += 1) {
+		if (disjunction->children.at(i).type != QueryNode::TERM) {
+			return false;
 		}
-
-		// Look up the search term in the hash table
-		authors_matches = author_table.get_paper_ids(author_term);
 	}
+	return true;
+}
 
 
 
-	// Filter out the paper ids in exlusions from possible matches
-	for (int i = 0; i < possible_matches.size(); i += 1) {
-		// If the exclusions is empty, the inner for loop will just never exceute
-		for (int j = 0; j < exclusions.size(); j += 1) {
-			if (possible_matches.at(i) == exclusions.at(j)) {
-				possible_matches.erase(possible_matches.begin() + i);
-				// decrement i by 1 so the next element won't be skipped since erase will move all remaining elements down by 1 index to fill the hole
-				i -= 1;
-				break;
+// The Ranking processor
+// This function ranks the final matches by their BM25 scores, and finds the top k ranked results, the best one first
+void rank_results(vector<DocId>& final_matches, SegmentedIndex& index, DocumentTable& doc_table, vector<string>& search_terms, BM25& bm25,
+	int k, vector<DocId>& top_results) {
+
+	// The score of a final match (article) is the sum of the BM25 scores of the search terms in it (see BM25.h). Everything the
+	// scores need is in the index: the term frequencies are stored in the posting lists, the document frequency of a term is the
+	// length of its posting lists, and the lengths of the articles are in the document table, so the texts of the articles 
+	// aren't read at all. The search terms are the stemmed words of the query, the words of its phrases included.
+	// The articles where the search terms are close to each other get a proximity boost (see BM25::proximity()), from the 
+	// positions of the terms the iterators are already on, so that doesn't read the texts either
+
+	vector<shared_ptr<Segment>> segments = index.snapshot();
+
+	// The collection is every article of the index. The deleted ones are still counted in the document frequencies until the 
+	// index is compacted, like in the posting lists
+	bm25.set_collection(doc_table.size() - index.get_live_docs().get_num_deleted(), doc_table.get_average_length());
+
+	// The posting lists are walked once in document id order
+	if (!is_sorted(final_matches.begin(), final_matches.end())) {
+		sort(final_matches.begin(), final_matches.end());
+	}
+
+	// One iterator per posting list of every search term, with the weight of its term
+	vector<PostingList::Iterator> iterators;
+	CoveringSpan span;
+	vector<const PostingList*> span_lists;
+	vector<double> idfs;
+	for (int i = 0; i < search_terms.size(); i += 1) {
+		vector<const PostingList*> lists;
+		int df = 0;
+		for (int s = 0; s < segments.size(); s += 1) {
+			const PostingList* postings = segments.at(s)->word_tree.get_postings(search_terms.at(i));
+			if (postings != nullptr) {
+				lists.push_back(postings);
+				df += postings->size();
 			}
 		}
+		for (int s = 0; s < lists.size(); s += 1) {
+			iterators.push_back(PostingList::Iterator(*lists.at(s)));
+			idfs.push_back(bm25.idf(df));
+		}
 	}
 
-	
-	// Find the intersection of possible_matches and authors_matches, only if the authors_matches is not empty
-	if (!authors_matches.empty()) {
-		vector<vector<string>> vecs; 
-		vecs.push_back(possible_matches);
-		vecs.push_back(authors_matches);
-		final_matches = intersection(vecs);
-	}
-	else {
-		final_matches = possible_matches;
+	// Every final match is scored once, document at a time: each iterator skips to it and adds the score of its term if the 
+	// document is in its list. The scores go straight into the top k, a final match whose search terms are all missing from
+	// it (e.g. it only matched the author) still ranks with a score of 0
+	TopK top_k(k);
+	for (int j = 0; j < final_matches.size(); j += 1) {
+		DocId doc = final_matches.at(j);
+		double score = 0;
+		span.clear();
+		span_lists.clear();
+		for (int t = 0; t < iterators.size(); t += 1) {
+			PostingList::Iterator& it = iterators.at(t);
+			it.advance(doc);
+			if (!it.at_end() && it.doc() == doc) {
+				score += bm25.score(it.freq(), doc_table.get_length(doc), idfs.at(t));
+
+				// A search term repeated in the query has the same list twice
+				const PostingList* list = &it.get_list();
+				if (bm25.has_proximity() && list->has_positions() && find(span_lists.begin(), span_lists.end(), list) == span_lists.end()) {
+					span.add(it.positions(), it.freq());
+					span_lists.push_back(list);
+				}
+			}
+		}
+		score += bm25.proximity(span.min_span(), span.num_terms());
+		top_k.push(doc, score);
 	}
 
+	top_k.get_results(top_results);
 }
 
 
 
-// The Ranking processor
-// This function ranks the final matches by their relevancy scores, and finds the top 15 ranked results
-void rank_results(vector<string>& final_matches, vector<Article>& articles, string& temp, vector<string>& top15_results) {
 
-	// There will be one map for each search term. Each map will store all the final matches (paper ids) as the keys, and the number of times 
-	// that particular search term appeared in those paper id as the values
 
-	// In terms of ranking, a search term in each of the final matches (articles) will have a relevancy score, the score is calculated by dividing the 
-	// number of times that search term appeared in the article by the size of the article's body text. 
+// The Ranking processor for OR queries
+// The documents that have any of the search terms are the matches of an OR query, most of them can't make the top k. Instead of
+// finding all of them and then scoring them, the query is evaluated by BlockMaxWand over the posting lists of the search terms,
+// which only scores the documents that can still get into the top k. The NOT and AUTHOR filters are evaluated for each segment
+// by a QueryPlanner, and filter the documents before they are scored. The segments hold separate ranges of document ids, so 
+// they are searched one after the other into the same top k.
+// The OR queries with phrases or nested operators are searched by perform_search() and ranked by rank_results() instead, a 
+// phrase has no posting list of its own to bound its score with
+void rank_or_query(const QueryNode& disjunction, vector<const QueryNode*>& filters, SegmentedIndex& index, DocumentTable& doc_table, 
+	BM25& bm25, int k, vector<DocId>& top_results) {
 
-	// To make sure that when a search term appeared more frequently in a long article, doesn't mean that article is more important 
+	vector<shared_ptr<Segment>> segments = index.snapshot();
+	const LiveDocs& live_docs = index.get_live_docs();
 
-	vector< unordered_map<string, double> > maps;
-	vector<string> search_terms = tokenize(temp);
+	report_missing_terms(disjunction, segments);
+	for (int f = 0; f < filters.size(); f += 1) {
+		report_missing_terms(*filters.at(f), segments);
+	}
 
-	AVLTree stop_words_tree;
-	load_stop_words(stop_words_tree);
+	vector<string> search_terms;
+	disjunction.get_search_terms(search_terms);
 
+	bm25.set_collection(doc_table.size() - live_docs.get_num_deleted(), doc_table.get_average_length());
 
-	// Initialize maps. One map for each search term
+	// The posting lists of every search term in every segment, and the weights of the terms
+	vector<vector<const PostingList*>> lists(segments.size());
+	vector<double> idfs;
 	for (int i = 0; i < search_terms.size(); i += 1) {
-		unordered_map<string, double> word_count_map;
-
-		for (int j = 0; j < final_matches.size(); j += 1) {
-
-			for (int k = 0; k < articles.size(); k += 1) {
-
-				// Get the text of one final match, find out the how many times the search term apppeared in the text
-				// Insert the final match paper id as the key and its relevancy_score as the value into the map for that particular search term
-				// 
-				if (final_matches.at(j) == articles.at(k).get_id()) {
-					// Get the body text from the right Article object and process it
-					string text = articles.at(k).get_text(); 
-					//to_lower(text);
-					vector<string> temp = tokenize(text);
-					// stop words removal
-					vector<string> tokens;  // A vector that stores words that are not stop words 
-					for (int i = 0; i < temp.size(); i += 1) {
-						if (!stop_words_tree.contain(temp.at(i))) {
-							tokens.push_back(temp.at(i));
-						}
-					}
-					//stem_words(temp);
-
-					// Get the count of the search term in that body text
-					double word_count = count(tokens.begin(), tokens.end(), search_terms.at(i));
-					double relev_score = (word_count / tokens.size());
-					// Insert the key-value pair, map[paper_id] = relev_score 
-					word_count_map[final_matches.at(j)] = relev_score;
-					break;
-				}
+		int df = 0;
+		for (int s = 0; s < segments.size(); s += 1) {
+			const PostingList* postings = segments.at(s)->word_tree.get_postings(search_terms.at(i));
+			lists.at(s).push_back(postings);
+			if (postings != nullptr) {
+				df += postings->size();
 			}
 		}
-
-		maps.push_back(word_count_map);
-	}
-
-
-	// Add up the relevancy scores in all the map for the same paper_id, store the sums in the final map as the values, and the corresponding 
-	// paper ids as the keys 
-	unordered_map<string, double> final_map;
-
-	for (int i = 0; i < final_matches.size(); i += 1) {
-		for (int j = 0; j < maps.size(); j += 1) {
-			final_map[final_matches.at(i)] += maps.at(j)[final_matches.at(i)];
-		}
+		idfs.push_back(bm25.idf(df));
 	}
 
+	TopK top_k(k);
+	for (int s = 0; s < segments.size(); s += 1) {
 
-	// To find the top 15 largest values in the final map, iterate through the map 15 times 
-	// For each iteration, find the max value, store its key in a vector, delete the key, find the next max value
-	// The max value is pushed back to the vector first, and the second max value, and so on, therefore, the 15 paper ids will be  
-	// sorted in decreasing order by their values in the vector 
-	for (int i = 0; i < final_map.size(); i += 1) {
-
-		double curr_max = 0;
-		string curr_key;
-		for (auto x : final_map) {
-			if (x.second > curr_max) {
-				curr_max = x.second;
-				curr_key = x.first;
+		// The documents of the segment the NOT operands have, and the ones every AUTHOR has
+		QueryPlanner planner(*segments.at(s), live_docs);
+		vector<DocId> exclusions, authors_matches;
+		bool has_author = false;
+		for (int f = 0; f < filters.size(); f += 1) {
+			if (filters.at(f)->type == QueryNode::NOT) {
+				planner.evaluate(filters.at(f)->children.at(0), exclusions);
+			}
+			else {
+				vector<DocId> author_docs;
+				planner.evaluate(*filters.at(f), author_docs);
+				if (has_author) {
+					Intersection::intersect(author_docs, authors_matches);
+				}
+				authors_matches = author_docs;
+				has_author = true;
 			}
 		}
+		// None of the articles of the segment are by the authors
+		if (has_author && authors_matches.empty()) {
+			continue;
+		}
+		sort(exclusions.begin(), exclusions.end());
+		DocFilter filter(exclusions, authors_matches);
 
-		top15_results.push_back(curr_key);
-		final_map.erase(curr_key);
-
-		if (i == 14) {
-			break;
+		BlockMaxWand wand(bm25, doc_table);
+		for (int i = 0; i < search_terms.size(); i += 1) {
+			if (lists.at(s).at(i) != nullptr) {
+				wand.add_list(*lists.at(s).at(i), idfs.at(i), &live_docs);
+			}
 		}
+		wand.search(top_k, filter);
 	}
+
+	top_k.get_results(top_results);
 }
 
 
@@ -784,7 +1351,7 @@ void rank_results(vector<string>& final_matches, vector<Article>& articles, stri
 
 
 // This function formats nd displays the top 15 ranked articles and lets the user open an article
-void display_results(vector<string>& top15_results, vector<Article>& articles, 
+void display_results(vector<DocId>& top15_results, vector<Article>& articles, DocumentStore& doc_store, DocumentTable& doc_table,
 	unordered_map<string, string>& published_date_map, unordered_map<string, string>& publication_map) {
 
 
@@ -793,34 +1360,32 @@ void display_results(vector<string>& top15_results, vector<Article>& articles,
 	int text_num = 1;
 
 	for (int i = 0; i < top15_results.size(); i += 1) {
-		for (int j = 0; j < articles.size(); j += 1) {
-			if (top15_results.at(i) == articles.at(j).get_id()) {
-				cout << text_num << "." << endl;                    			  // label each article with its ranking number
-				cout << "Title:          " << articles.at(j).get_title() << endl;			      
-				// Display the first 3 authors
-				cout << "Author:         ";
-				if (articles.at(j).get_authors().at(0) == "N/A") {
-					cout << "N/A" << endl;
-				}
-				else {
-					for (int k = 0; k < articles.at(j).get_authors().size(); k += 1) {
-						if (k == 2) {
-							cout << articles.at(j).get_authors().at(k) << "..." << endl;
-							break;
-						}
-						cout << articles.at(j).get_authors().at(k) << ", ";
-					}
+		// The document id is the position of the article in the articles vector and in the document store
+		DocId j = top15_results.at(i);
+		string& paper_id = doc_table.get_paper_id(j);
+
+		cout << text_num << "." << endl;                    			  // label each article with its ranking number
+		cout << "Title:          " << articles.at(j).get_title() << endl;			      
+		// Display the first 3 authors
+		cout << "Author:         ";
+		if (articles.at(j).get_authors().at(0) == "N/A") {
+			cout << "N/A" << endl;
+		}
+		else {
+			for (int k = 0; k < articles.at(j).get_authors().size(); k += 1) {
+				if (k == 2) {
+					cout << articles.at(j).get_authors().at(k) << "..." << endl;
+					break;
 				}
-
-				cout << "Date published: " << published_date_map[top15_results.at(i)] << endl;            
-				cout << "Publication:    " << publication_map[top15_results.at(i)] << endl << endl;       
-				// store the text for each of the 15 articles in a map as the values, and its ranking number (1~15) as the keys 
-				text_map[text_num] = articles.at(j).get_text();  
-				text_num += 1;  
-				break;
+				cout << articles.at(j).get_authors().at(k) << ", ";
 			}
 		}
 
+		cout << "Date published: " << published_date_map[paper_id] << endl;            
+		cout << "Publication:    " << publication_map[paper_id] << endl << endl;       
+		// store the text for each of the 15 articles in a map as the values, and its ranking number (1~15) as the keys 
+		text_map[text_num] = doc_store.get_text(j);  
+		text_num += 1;  
 	}
 
 	// Allow user to choose an article to display the first 300 words of the text
@@ -858,66 +1423,177 @@ void display_results(vector<string>& top15_results, vector<Article>& articles,
 }
 
 
-void restore_word_index(AVLTree& word_tree) {
+// The word index was written in order, so the words come out of the file sorted and the AVLTree is built balanced from them in
+// one go, instead of inserting every (word, paper id) line on its own
+void restore_word_index(AVLTree& word_tree, DocumentTable& doc_table, int num_threads) {
 
-	ifstream index_ifs("word_index.txt");
-	if (!index_ifs.is_open()) {
+	vector<string> words;
+	vector<vector<DocId>> id_lists;
+	vector<PostingList> postings;
+	if (!restore_records("word_index.txt", doc_table, num_threads, true, words, id_lists, postings)) {
 		cout << "Couldn't open file.." << endl;
+		return;
 	}
 
-	// In the index file, every word is followed by a list of paper ids
-	// Read in the first line, which is a word, and read in the second line, which is its first paper id
-	// While the next line read in has size 40 (paper id size), keep inserting the same word with different ids into the AVLTree
-	// until the next word is read in, which we can assume it will not be size 40
-	string word;
-	string paper_id;
+	bool sorted = true;
+	for (int i = 1; i < words.size(); i += 1) {
+		if (words.at(i - 1) >= words.at(i)) {
+			sorted = false;
+			break;
+		}
+	}
+
+	if (sorted) {
+		word_tree.build(words, postings);
+		return;
+	}
 
-	getline(index_ifs, word);
+	// A file that wasn't written by write_to_file, insert its words one by one
+	word_tree.clear_tree();
+	vector<DocId> docs;
+	for (int i = 0; i < words.size(); i += 1) {
+		docs.clear();
+		postings.at(i).decode(docs);
+		for (int j = 0; j < docs.size(); j += 1) {
+			word_tree.insert(words.at(i), docs.at(j));
+		}
+	}
+	word_tree.seal();
+}
+
+
+void restore_author_index(HashTable& author_table, DocumentTable& doc_table, int num_threads) {
+
+	vector<string> authors;
+	vector<vector<DocId>> id_lists;
+	vector<PostingList> postings;
+	if (!restore_records("author_index.txt", doc_table, num_threads, false, authors, id_lists, postings)) {
+		cout << "Couldn't open file.." << endl;
+		return;
+	}
 
-	while (!index_ifs.eof()) {
-		getline(index_ifs, paper_id);
+	// Every author is looked up once for its whole list of ids
+	for (int i = 0; i < authors.size(); i += 1) {
+		author_table.insert(authors.at(i), id_lists.at(i));
+	}
+}
+
+
+// Reads a text index file (word_index.txt or author_index.txt). In those files, every word or author is followed by the lines of
+// the paper ids it appears in, and we can assume a word or an author is never 40 characters long (the paper id size), so a record
+// starts at every line that isn't 40 characters long.
+// The file is mapped and cut into num_threads parts on record boundaries, every part is parsed by its own thread, and the records
+// are put back together in the order of the file. With encode, the ids of every record are also turned into a PostingList by the
+// threads (and id_lists is left empty)
+// Returns false if the file couldn't be opened
+bool restore_records(string file_path, DocumentTable& doc_table, int num_threads, bool encode,
+	vector<string>& names, vector<vector<DocId>>& id_lists, vector<PostingList>& postings) {
+
+	MappedFile index_file(file_path);
+	if (!index_file.is_open()) {
+		return false;
+	}
+	const char* data = index_file.data();
+	const char* end = data + index_file.size();
+
+	if (num_threads < 1) {
+		num_threads = 1;
+	}
 
-		while (paper_id.size() == 40) {
-			word_tree.insert(word, paper_id);
-			getline(index_ifs, paper_id);
-			if (paper_id.size() != 40) {
-				word = paper_id;
+	// Move every cut forward to the start of the next record
+	vector<const char*> cuts(num_threads + 1, end);
+	cuts.at(0) = data;
+	for (int t = 1; t < num_threads; t += 1) {
+		const char* cut = max(data + index_file.size() * t / num_threads, cuts.at(t - 1));
+		if (cut != data && cut < end && *(cut - 1) != '\n') {
+			const char* line_end = (const char*) memchr(cut, '\n', end - cut);
+			cut = (line_end == nullptr) ? end : line_end + 1;
+		}
+		while (cut < end) {
+			const char* line_end = (const char*) memchr(cut, '\n', end - cut);
+			if (line_end == nullptr) {
+				line_end = end;
+			}
+			if (line_end - cut != 40) {
 				break;
 			}
+			cut = min(line_end + 1, end);
 		}
+		cuts.at(t) = cut;
 	}
-}
 
+	if (num_threads == 1) {
+		restore_partition(data, end, doc_table, encode, names, id_lists, postings);
+		return true;
+	}
 
-void restore_author_index(HashTable& author_table) {
+	vector<vector<string>> partial_names(num_threads);
+	vector<vector<vector<DocId>>> partial_id_lists(num_threads);
+	vector<vector<PostingList>> partial_postings(num_threads);
+	vector<thread> workers;
+	for (int t = 0; t < num_threads; t += 1) {
+		workers.push_back(thread(restore_partition, cuts.at(t), cuts.at(t + 1), ref(doc_table), encode,
+			ref(partial_names.at(t)), ref(partial_id_lists.at(t)), ref(partial_postings.at(t))));
+	}
+	for (int t = 0; t < num_threads; t += 1) {
+		workers.at(t).join();
+	}
 
-	ifstream index_ifs("author_index.txt");
-	if (!index_ifs.is_open()) {
-		cout << "Couldn't open file.." << endl;
+	for (int t = 0; t < num_threads; t += 1) {
+		move(partial_names.at(t).begin(), partial_names.at(t).end(), back_inserter(names));
+		move(partial_id_lists.at(t).begin(), partial_id_lists.at(t).end(), back_inserter(id_lists));
+		move(partial_postings.at(t).begin(), partial_postings.at(t).end(), back_inserter(postings));
 	}
+	return true;
+}
 
-	// Same approach as for restoring word_index
-	string author;
-	string paper_id;
 
-	getline(index_ifs, author);
+// Parses the records in [begin, end), which starts on a record. The paper ids are turned back into the document ids they were 
+// given when the articles were indexed, the ones that aren't indexed any more are dropped, and so is a record left without ids.
+// The DocumentTable is only read, so the threads can share it
+void restore_partition(const char* begin, const char* end, DocumentTable& doc_table, bool encode,
+	vector<string>& names, vector<vector<DocId>>& id_lists, vector<PostingList>& postings) {
 
-	while (!index_ifs.eof()) {
-		getline(index_ifs, paper_id);
+	string paper_id;
+	DocId doc;
+	vector<DocId> docs;
+	string name;
+	bool has_name = false;
 
-		if (paper_id.size() != 40) {
-			author = paper_id;
+	const char* line = begin;
+	while (true) {
+		const char* line_end = (line < end) ? (const char*) memchr(line, '\n', end - line) : nullptr;
+		if (line_end == nullptr) {
+			line_end = end;
 		}
-		else {
-			while (paper_id.size() == 40) {
-				author_table.insert(author, paper_id);
-				getline(index_ifs, paper_id);
-				if (paper_id.size() != 40) {
-					author = paper_id;
-					break;
+
+		// The end of a record
+		if (line >= end || line_end - line != 40) {
+			if (has_name && !docs.empty()) {
+				names.push_back(name);
+				if (encode) {
+					sort(docs.begin(), docs.end());
+					postings.push_back(PostingList(docs));
+				}
+				else {
+					id_lists.push_back(docs);
 				}
 			}
+			if (line >= end) {
+				break;
+			}
+			name.assign(line, line_end - line);
+			has_name = true;
+			docs.clear();
+		}
+		else if (has_name) {
+			paper_id.assign(line, 40);
+			if (doc_table.find(paper_id, doc)) {
+				docs.push_back(doc);
+			}
 		}
+
+		line = min(line_end + 1, end);
 	}
 }
 
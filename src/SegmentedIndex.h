@@ -0,0 +1,505 @@
+#ifndef SEGMENTEDINDEX_H
+#define SEGMENTEDINDEX_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>             // for rename() and remove()
+
+#include "AVLTree.h"
+#include "HashTable.h"
+#include "DocumentTable.h"
+#include "IndexFile.h"
+#include "LiveDocs.h"
+
+using namespace std;
+
+
+// A Segment is one part of the index: the words and the authors of the documents in [first_doc, end_doc).
+// A segment written to an index file is never changed again, its posting lists are views on the mapped file
+struct Segment {
+
+	// The index file of the segment, "" if it only lives in memory
+	string file_path;
+	IndexFile file;
+	AVLTree word_tree;
+	HashTable author_table;
+	DocId first_doc = 0;
+	DocId end_doc = 0;
+
+	Segment(int num_buckets) : author_table(num_buckets) {
+
+	}
+
+	~Segment() {
+		word_tree.clear_tree();
+	}
+
+	int num_docs() {
+		return end_doc - first_doc;
+	}
+
+};
+
+
+// The SegmentedIndex splits the index into segments, like a log-structured merge tree:
+//  - the base is the index of the whole dataset, opened from index.bin at startup (or built when index.bin isn't the index of
+//    the dataset any more)
+//  - the documents added afterwards are indexed into an in-memory buffer, which is flushed to a new immutable segment file
+//  - the segment files are listed in order in a manifest (MANIFEST), so they can be restored, and reopened at the next startup
+//    if the dataset still has the same documents
+// A query fans out: it is run on every segment and the matches are appended in segment order. Every segment holds a later range
+// of document ids than the one before it, so the appended matches stay sorted.
+// The more segments there are, the more lookups a query makes, so a background thread merges them with a tiered policy: the
+// segments are put in tiers by their number of documents (tier t holds between MERGE_FACTOR^t and MERGE_FACTOR^(t+1) - 1), and as
+// soon as MERGE_FACTOR neighbouring segments are in the same tier they are merged into one segment of the next tier. Only
+// neighbours are merged, so the ranges of document ids stay in order. The number of segments grows with the log of the number of
+// documents added, and every document is rewritten once per tier.
+// The base isn't merged, it is already the biggest segment by far.
+// Deleting a document marks it in the LiveDocs of the index and appends it to the deletes file (DELETES). The queries skip it
+// right away, and it is removed from the postings when its segment is merged or when the index is compacted.
+class SegmentedIndex {
+
+private:
+	static constexpr const char* MANIFEST = "index.segments";
+	static constexpr const char* DELETES = "index.deletes";
+	static const int MERGE_FACTOR = 4;
+	// The segments are small next to the base, their author tables don't need as many buckets
+	static constexpr int SEGMENT_BUCKETS = 4099;
+
+	shared_ptr<Segment> base;
+	shared_ptr<Segment> buffer;
+	// The segments flushed since the base, in the order of their document ids
+	vector<shared_ptr<Segment>> segments;
+	// The number in the file name of the next segment
+	int next_segment = 1;
+	// The document table as of the last flush, for the merge thread (the real one grows while documents are added)
+	DocumentTable flushed_docs;
+	// Bumped when the segments are dropped, a merge that started before that is thrown away
+	int generation = 0;
+	// The deleted documents, only changed by the menu thread
+	LiveDocs live_docs;
+
+	// Guards everything above, except the content of the base and the buffer, which are only used by the menu thread
+	mutex segments_mutex;
+	condition_variable merge_cv;
+	bool stopping = false;
+	// Set when a merged segment couldn't be written, the segments aren't merged any more after that
+	bool merge_failed = false;
+	thread merger;
+
+
+	static int get_tier(int num_docs) {
+		int tier = 0;
+		while (num_docs >= MERGE_FACTOR) {
+			num_docs /= MERGE_FACTOR;
+			tier += 1;
+		}
+		return tier;
+	}
+
+	// The position of the first of MERGE_FACTOR neighbouring segments in the same tier, or -1 if there are none.
+	// Called with segments_mutex held
+	int find_merge() {
+		for (int i = 0; i + MERGE_FACTOR <= segments.size(); i += 1) {
+			int tier = get_tier(segments.at(i)->num_docs());
+			int j = i + 1;
+			while (j < i + MERGE_FACTOR && get_tier(segments.at(j)->num_docs()) == tier) {
+				j += 1;
+			}
+			if (j == i + MERGE_FACTOR) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+
+	// Maps a segment file and restores its words and authors
+	static shared_ptr<Segment> load_segment(const string& file_path, DocumentTable& doc_table, DocId first_doc, DocId end_doc) {
+		shared_ptr<Segment> segment = make_shared<Segment>(SEGMENT_BUCKETS);
+		if (!segment->file.open(file_path)) {
+			return nullptr;
+		}
+		segment->file.load(segment->word_tree, segment->author_table, doc_table);
+		segment->file_path = file_path;
+		segment->first_doc = first_doc;
+		segment->end_doc = end_doc;
+		return segment;
+	}
+
+
+	// Writes the list of segment files, with the range of document ids of each one, next to the manifest and renames it over
+	// the manifest. Called with segments_mutex held
+	void write_manifest() {
+		string temp_path = string(MANIFEST) + ".tmp";
+		ofstream manifest_ofs(temp_path, ios::trunc);
+		for (int i = 0; i < segments.size(); i += 1) {
+			if (segments.at(i)->file_path != "") {
+				manifest_ofs << segments.at(i)->file_path << " " << segments.at(i)->first_doc << " " << segments.at(i)->end_doc << endl;
+			}
+		}
+		manifest_ofs.close();
+		if (!manifest_ofs || rename(temp_path.c_str(), MANIFEST) != 0) {
+			cout << "Couldn't write " << MANIFEST << ".." << endl;
+		}
+	}
+
+
+	// Deletes the segment files and the manifest, when the base is rebuilt with other documents their document ids don't mean
+	// anything any more. The deletes file is kept, restore() only takes the deletes whose paper id still has the same document id.
+	// Called with segments_mutex held
+	void remove_segment_files() {
+		ifstream manifest_ifs(MANIFEST);
+		string file_path;
+		DocId first_doc, end_doc;
+		while (manifest_ifs >> file_path >> first_doc >> end_doc) {
+			remove(file_path.c_str());
+		}
+		manifest_ifs.close();
+		remove(MANIFEST);
+
+		segments.clear();
+		next_segment = 1;
+		generation += 1;
+	}
+
+
+	// The merge thread, it sleeps until a flush makes a merge possible
+	void merge_loop() {
+
+		unique_lock<mutex> lock(segments_mutex);
+		while (true) {
+			merge_cv.wait(lock, [this] { return stopping || (!merge_failed && find_merge() >= 0); });
+			if (stopping) {
+				return;
+			}
+
+			int first = find_merge();
+			vector<shared_ptr<Segment>> run(segments.begin() + first, segments.begin() + first + MERGE_FACTOR);
+			DocumentTable doc_table = flushed_docs;
+			LiveDocs merge_live_docs = live_docs;
+			int merge_generation = generation;
+			string file_path = segment_path(next_segment);
+			next_segment += 1;
+
+			// The segments being merged are immutable, queries keep reading them while the merged segment is written
+			lock.unlock();
+			shared_ptr<Segment> merged = merge_segments(run, doc_table, merge_live_docs, file_path);
+			lock.lock();
+
+			if (merged == nullptr) {
+				cout << "Couldn't write " << file_path << ".." << endl;
+				merge_failed = true;
+				continue;
+			}
+
+			auto it = find(segments.begin(), segments.end(), run.at(0));
+			if (merge_generation != generation || segments.end() - it < MERGE_FACTOR || !equal(run.begin(), run.end(), it)) {
+				remove(file_path.c_str());
+				continue;
+			}
+
+			it = segments.erase(it, it + MERGE_FACTOR);
+			segments.insert(it, merged);
+			write_manifest();
+
+			// A query that still holds the old segments keeps their mappings, the files can go
+			for (int i = 0; i < run.size(); i += 1) {
+				remove(run.at(i)->file_path.c_str());
+			}
+		}
+	}
+
+
+	// Merges the words and the authors of neighbouring segments, without the deleted documents, and writes them to file_path.
+	// The segments are in the order of their document ids, so appending their ids keeps the ids of every word sorted
+	static shared_ptr<Segment> merge_segments(vector<shared_ptr<Segment>>& run, DocumentTable& doc_table, const LiveDocs& live_docs, const string& file_path) {
+
+		AVLTree word_tree;
+		HashTable author_table(SEGMENT_BUCKETS);
+		for (int i = 0; i < run.size(); i += 1) {
+			word_tree.merge(run.at(i)->word_tree);
+			author_table.merge(run.at(i)->author_table);
+		}
+		word_tree.remove_docs(live_docs);
+		author_table.remove_docs(live_docs);
+
+		bool written = IndexFile::write(file_path, word_tree, author_table, doc_table);
+		word_tree.clear_tree();
+		if (!written) {
+			return nullptr;
+		}
+
+		// The merged segment is read back from its file, so its posting lists are views like the ones of the other segments
+		return load_segment(file_path, doc_table, run.front()->first_doc, run.back()->end_doc);
+	}
+
+
+public:
+	// The buffer is flushed to a segment once it holds this many documents, and at the end of every batch of added documents
+	static constexpr int BUFFER_DOCS = 1024;
+
+	SegmentedIndex(int base_buckets) {
+		base = make_shared<Segment>(base_buckets);
+		buffer = make_shared<Segment>(SEGMENT_BUCKETS);
+		merger = thread(&SegmentedIndex::merge_loop, this);
+	}
+
+	~SegmentedIndex() {
+		close();
+	}
+
+	SegmentedIndex(const SegmentedIndex&) = delete;
+	SegmentedIndex& operator=(const SegmentedIndex&) = delete;
+
+
+	// The file of segment number n
+	static string segment_path(int n) {
+		return "index." + to_string(n) + ".bin";
+	}
+
+
+	// The index of the dataset, the SearchEngine builds and restores it in place
+	AVLTree& get_base_words() {
+		return base->word_tree;
+	}
+
+	HashTable& get_base_authors() {
+		return base->author_table;
+	}
+
+	// The buffer the added documents are indexed into, until they are flushed
+	Segment& get_buffer() {
+		return *buffer;
+	}
+
+
+	// Writes the buffer, which holds the documents from first_doc to the end of doc_table, as the next segment. Its words
+	// are then searched from the segment file, and the buffer starts over empty
+	void flush(DocumentTable& doc_table, DocId first_doc) {
+
+		if (first_doc >= doc_table.size()) {
+			return;
+		}
+
+		string file_path;
+		{
+			lock_guard<mutex> lock(segments_mutex);
+			file_path = segment_path(next_segment);
+			next_segment += 1;
+		}
+
+		shared_ptr<Segment> segment = nullptr;
+		if (IndexFile::write(file_path, buffer->word_tree, buffer->author_table, doc_table)) {
+			segment = load_segment(file_path, doc_table, first_doc, doc_table.size());
+		}
+		// The documents stay searchable from memory if they can't be written
+		if (segment == nullptr) {
+			cout << "Couldn't write " << file_path << ".." << endl;
+			segment = buffer;
+			segment->first_doc = first_doc;
+			segment->end_doc = doc_table.size();
+		}
+
+		lock_guard<mutex> lock(segments_mutex);
+		segments.push_back(segment);
+		flushed_docs = doc_table;
+		write_manifest();
+		buffer = make_shared<Segment>(SEGMENT_BUCKETS);
+		merge_cv.notify_one();
+	}
+
+
+	// The segments a query runs on, from the first document id to the last: the base, the flushed segments and the buffer.
+	// Holding them keeps them alive even if they are merged away meanwhile
+	vector<shared_ptr<Segment>> snapshot() {
+		lock_guard<mutex> lock(segments_mutex);
+		vector<shared_ptr<Segment>> result;
+		result.push_back(base);
+		result.insert(result.end(), segments.begin(), segments.end());
+		result.push_back(buffer);
+		return result;
+	}
+
+
+	// Reopens the segments listed in the manifest, on top of a restored base, and reads back the deleted documents
+	void restore(DocumentTable& doc_table) {
+
+		lock_guard<mutex> lock(segments_mutex);
+		segments.clear();
+		generation += 1;
+
+		// A deleted document is written with its paper_id, in case the document ids in the file aren't the ones of doc_table
+		live_docs.clear();
+		ifstream deletes_ifs(DELETES);
+		DocId doc;
+		string paper_id;
+		while (deletes_ifs >> doc >> paper_id) {
+			if (doc < doc_table.size() && doc_table.get_paper_id(doc) == paper_id) {
+				live_docs.remove(doc);
+			}
+		}
+
+		ifstream manifest_ifs(MANIFEST);
+		string file_path;
+		DocId first_doc, end_doc;
+		while (manifest_ifs >> file_path >> first_doc >> end_doc) {
+			shared_ptr<Segment> segment = load_segment(file_path, doc_table, first_doc, end_doc);
+			if (segment == nullptr) {
+				cout << "Couldn't restore " << file_path << ".." << endl;
+				continue;
+			}
+			segments.push_back(segment);
+
+			int n = 0;
+			if (sscanf(file_path.c_str(), "index.%d.bin", &n) == 1) {
+				next_segment = max(next_segment, n + 1);
+			}
+		}
+		flushed_docs = doc_table;
+		merge_cv.notify_one();
+	}
+
+
+	// Drops the segments from memory, their files stay so they can be restored
+	void clear() {
+		lock_guard<mutex> lock(segments_mutex);
+		segments.clear();
+		buffer = make_shared<Segment>(SEGMENT_BUCKETS);
+		generation += 1;
+	}
+
+
+	// Called after the base is built or opened at startup, before restore(). If the segments of the previous run were written on top of
+	// the same documents as the ones of doc_table, the documents they added are appended to doc_table (with their lengths) and
+	// true is returned. Otherwise the segment files are deleted
+	bool reopen_documents(DocumentTable& doc_table) {
+		lock_guard<mutex> lock(segments_mutex);
+
+		// Every segment file has the documents of the whole index as of when it was written, so the last one has all of them
+		ifstream manifest_ifs(MANIFEST);
+		string file_path, last_path;
+		DocId first_doc, end_doc, last_end = 0;
+		while (manifest_ifs >> file_path >> first_doc >> end_doc) {
+			if (end_doc > last_end) {
+				last_path = file_path;
+				last_end = end_doc;
+			}
+		}
+		manifest_ifs.close();
+
+		IndexFile last_file;
+		vector<string> paper_ids;
+		vector<uint32_t> lengths;
+		if (last_path != "" && last_file.open(last_path)) {
+			paper_ids = last_file.get_paper_ids(lengths);
+		}
+
+		bool same_base = paper_ids.size() >= last_end && paper_ids.size() > doc_table.size();
+		for (int i = 0; i < doc_table.size() && same_base; i += 1) {
+			same_base = doc_table.get_paper_id(i) == paper_ids.at(i);
+		}
+		if (!same_base) {
+			remove_segment_files();
+			return false;
+		}
+
+		for (int i = doc_table.size(); i < last_end; i += 1) {
+			doc_table.add(paper_ids.at(i), lengths.at(i));
+		}
+		return true;
+	}
+
+
+	// Deletes the document with a paper_id. Returns false if it isn't indexed, or was already deleted
+	bool delete_document(const string& paper_id, DocumentTable& doc_table) {
+		DocId doc;
+		if (!doc_table.find(paper_id, doc)) {
+			return false;
+		}
+
+		lock_guard<mutex> lock(segments_mutex);
+		if (!live_docs.remove(doc)) {
+			return false;
+		}
+		ofstream deletes_ofs(DELETES, ios::app);
+		deletes_ofs << doc << " " << paper_id << endl;
+		return true;
+	}
+
+
+	// The deleted documents, every posting list read by a query is filtered with them
+	const LiveDocs& get_live_docs() {
+		return live_docs;
+	}
+
+
+	// Rewrites the segments holding deleted documents without them. The base is compacted by the SearchEngine, which owns
+	// index.bin
+	void compact(DocumentTable& doc_table) {
+
+		lock_guard<mutex> lock(segments_mutex);
+		bool changed = false;
+		for (int i = 0; i < segments.size(); i += 1) {
+			shared_ptr<Segment> segment = segments.at(i);
+			if (!live_docs.any_deleted(segment->first_doc, segment->end_doc)) {
+				continue;
+			}
+
+			vector<shared_ptr<Segment>> run(1, segment);
+			string file_path = segment_path(next_segment);
+			next_segment += 1;
+			shared_ptr<Segment> compacted = merge_segments(run, doc_table, live_docs, file_path);
+			if (compacted == nullptr) {
+				cout << "Couldn't write " << file_path << ".." << endl;
+				continue;
+			}
+
+			segments.at(i) = compacted;
+			remove(segment->file_path.c_str());
+			changed = true;
+		}
+		if (changed) {
+			write_manifest();
+		}
+	}
+
+
+	int get_num_segments() {
+		lock_guard<mutex> lock(segments_mutex);
+		return segments.size();
+	}
+
+	int get_num_segment_docs() {
+		lock_guard<mutex> lock(segments_mutex);
+		int total = 0;
+		for (int i = 0; i < segments.size(); i += 1) {
+			total += segments.at(i)->num_docs();
+		}
+		return total;
+	}
+
+
+	// Stops the merge thread, once the merge it is running (if any) is done
+	void close() {
+		{
+			lock_guard<mutex> lock(segments_mutex);
+			stopping = true;
+		}
+		merge_cv.notify_one();
+		if (merger.joinable()) {
+			merger.join();
+		}
+	}
+
+};
+
+
+#endif
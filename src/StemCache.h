@@ -0,0 +1,124 @@
+#ifndef STEMCACHE_H
+#define STEMCACHE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+
+#include "../utils/porter2_stemmer.h"  // word stemmer
+
+using namespace std;
+
+
+// The StemCache remembers the stem of every word it has stemmed, so Porter2Stemmer only runs once per unique word instead of
+// once per occurrence. The words are split over shards by their hash, and each shard has its own lock, so the worker threads
+// of the index processor rarely wait on each other. Most lookups are hits, which only take a shared lock.
+// The hits and misses are counted per shard, next to its lock, and every shard has cache lines of its own, so two threads
+// looking up words of different shards never write to the same cache line.
+// The cache is bounded: once a shard is full, new words are still stemmed but no longer remembered.
+class StemCache {
+
+private:
+	static const int NUM_SHARDS = 16;
+
+	struct alignas(64) Shard {
+		unordered_map<string, string> stems;
+		shared_mutex lock;
+		atomic<long long> hits{0};
+		atomic<long long> misses{0};
+	};
+
+	vector<Shard> shards;
+	int shard_capacity;
+
+
+	Shard& get_shard(const string& word) {
+		hash<string> h;
+		return shards.at(h(word) % NUM_SHARDS);
+	}
+
+public:
+
+	// capacity is the maximum number of words remembered
+	StemCache(int capacity = 1 << 20) : shards(NUM_SHARDS) {
+		shard_capacity = capacity / NUM_SHARDS;
+	}
+
+
+	// Replaces the word by its stem, the same as calling Porter2Stemmer::trim() and Porter2Stemmer::stem() on it
+	void stem(string& word) {
+
+		Shard& shard = get_shard(word);
+
+		{
+			shared_lock<shared_mutex> reader(shard.lock);
+			auto it = shard.stems.find(word);
+			if (it != shard.stems.end()) {
+				word = it->second;
+				shard.hits.fetch_add(1, memory_order_relaxed);
+				return;
+			}
+		}
+
+		// Stem the word in its own buffer, the stem is never longer than the word
+		shard.misses.fetch_add(1, memory_order_relaxed);
+		string surface = word;
+		word.resize(Porter2Stemmer::trim(&word[0], word.size()));
+		word.resize(Porter2Stemmer::stem(&word[0], word.size()));
+
+		unique_lock<shared_mutex> writer(shard.lock);
+		if (shard.stems.size() < shard_capacity) {
+			shard.stems.emplace(surface, word);
+		}
+	}
+
+
+	long long get_hits() {
+		long long total = 0;
+		for (int i = 0; i < NUM_SHARDS; i += 1) {
+			total += shards.at(i).hits.load(memory_order_relaxed);
+		}
+		return total;
+	}
+
+	long long get_misses() {
+		long long total = 0;
+		for (int i = 0; i < NUM_SHARDS; i += 1) {
+			total += shards.at(i).misses.load(memory_order_relaxed);
+		}
+		return total;
+	}
+
+	double get_hit_rate() {
+		long long hits = get_hits();
+		long long lookups = hits + get_misses();
+		return lookups == 0 ? 0 : (double) hits / lookups;
+	}
+
+	int size() {
+		int total = 0;
+		for (int i = 0; i < NUM_SHARDS; i += 1) {
+			shared_lock<shared_mutex> reader(shards.at(i).lock);
+			total += shards.at(i).stems.size();
+		}
+		return total;
+	}
+
+	void clear() {
+		for (int i = 0; i < NUM_SHARDS; i += 1) {
+			unique_lock<shared_mutex> writer(shards.at(i).lock);
+			shards.at(i).stems.clear();
+			shards.at(i).hits = 0;
+			shards.at(i).misses = 0;
+		}
+	}
+
+};
+
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef STOPWORDS_H
+#define STOPWORDS_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+
+// The stop word list generated from stop-words-list.txt. Without it the list is read from the file when the program starts
+#if __has_include("StopWordList.h")
+#include "StopWordList.h"
+#define HAS_STOP_WORD_LIST 1
+#endif
+
+using namespace std;
+
+
+// The stop words are kept in a minimal perfect hash table: every stop word has its own slot in a table with exactly one slot
+// per word, so checking a word is one hash to find its slot and one compare with the word in that slot.
+//
+// The table is built with "hash and displace": the words are first hashed into as many buckets as there are words, then the
+// buckets are placed from the biggest to the smallest. For a bucket with several words, we look for the first displacement d
+// that sends all of its words to free slots, and remember d for the bucket. A bucket with one word just takes the next free
+// slot, which is remembered as -(slot + 1).
+//
+// The same code builds the table at compile time from the generated STOP_WORD_LIST, or at run time from a stop word file.
+
+
+// FNV-1a hash of the word
+constexpr uint32_t stop_word_hash(string_view word, uint32_t seed) {
+	uint32_t h = 2166136261u ^ seed;
+	for (size_t i = 0; i < word.size(); i += 1) {
+		h ^= (unsigned char) word[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+// Where the displacement d sends a word with hash h
+constexpr uint32_t stop_word_slot_hash(uint32_t h, int d) {
+	h ^= (uint32_t) d * 0x9E3779B9u;
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	return h;
+}
+
+
+// Builds the perfect hash table of the n words. Words, Ints and Hashes are either std::arrays (at compile time) or vectors
+// (at run time) of n elements, the words must be unique.
+// On success, slot_words holds the word of every slot and displacements the displacement of every bucket. Returns false if
+// the words can't be placed with this seed (two of them have the same hash), then another seed has to be tried
+template <class Words, class Ints, class Hashes>
+constexpr bool build_perfect_hash(const Words& words, int n, uint32_t seed, Words& slot_words, Ints& displacements,
+	Ints& slot_keys, Ints& bucket_start, Ints& bucket_keys, Ints& stamps, Hashes& hashes) {
+
+	// Counting sort the words by bucket, so the words of bucket b are bucket_keys[bucket_start[b] .. bucket_start[b + 1])
+	int max_size = 0;
+	for (int b = 0; b < n; b += 1) {
+		displacements[b] = 0;
+		bucket_start[b] = 0;
+		slot_keys[b] = -1;
+		stamps[b] = 0;
+	}
+	for (int k = 0; k < n; k += 1) {
+		hashes[k] = stop_word_hash(words[k], seed);
+		bucket_start[hashes[k] % n] += 1;
+	}
+	int total = 0;
+	for (int b = 0; b < n; b += 1) {
+		int size = bucket_start[b];
+		max_size = max(max_size, size);
+		bucket_start[b] = total;
+		total += size;
+	}
+	for (int k = 0; k < n; k += 1) {
+		int b = hashes[k] % n;
+		bucket_keys[bucket_start[b]] = k;
+		bucket_start[b] += 1;
+	}
+	// bucket_start[b] is now where bucket b ends, which is where bucket b + 1 starts
+	auto begin_of = [&](int b) { return b == 0 ? 0 : bucket_start[b - 1]; };
+
+	// Place the buckets with more than one word, biggest first
+	int stamp = 0;
+	for (int size = max_size; size >= 2; size -= 1) {
+		for (int b = 0; b < n; b += 1) {
+			if (bucket_start[b] - begin_of(b) != size) {
+				continue;
+			}
+
+			for (int d = 1; ; d += 1) {
+				if (d > 1000000) {
+					return false;
+				}
+
+				// stamps[slot] == stamp marks the slots already taken by this try
+				stamp += 1;
+				bool fits = true;
+				for (int i = begin_of(b); i < bucket_start[b]; i += 1) {
+					int slot = stop_word_slot_hash(hashes[bucket_keys[i]], d) % n;
+					if (slot_keys[slot] != -1 || stamps[slot] == stamp) {
+						fits = false;
+						break;
+					}
+					stamps[slot] = stamp;
+				}
+
+				if (fits) {
+					for (int i = begin_of(b); i < bucket_start[b]; i += 1) {
+						slot_keys[stop_word_slot_hash(hashes[bucket_keys[i]], d) % n] = bucket_keys[i];
+					}
+					displacements[b] = d;
+					break;
+				}
+			}
+		}
+	}
+
+	// The buckets with one word take the free slots in order
+	int free_slot = 0;
+	for (int b = 0; b < n; b += 1) {
+		if (bucket_start[b] - begin_of(b) != 1) {
+			continue;
+		}
+		while (slot_keys[free_slot] != -1) {
+			free_slot += 1;
+		}
+		slot_keys[free_slot] = bucket_keys[begin_of(b)];
+		displacements[b] = -free_slot - 1;
+	}
+
+	for (int slot = 0; slot < n; slot += 1) {
+		slot_words[slot] = words[slot_keys[slot]];
+	}
+	return true;
+}
+
+
+// Finds the slot of the word in a table built by build_perfect_hash, the word is a stop word if it is the word in that slot
+template <class Words, class Ints>
+constexpr bool perfect_hash_contains(const Words& slot_words, const Ints& displacements, int n, uint32_t seed, string_view word) {
+	if (n == 0) {
+		return false;
+	}
+	uint32_t h = stop_word_hash(word, seed);
+	int d = displacements[h % n];
+	int slot = d < 0 ? -d - 1 : stop_word_slot_hash(h, d) % n;
+	return slot_words[slot] == word;
+}
+
+
+// The perfect hash table of a list of N unique words, built at compile time
+template <size_t N>
+struct StopWordTable {
+	array<string_view, N> slot_words{};
+	array<int, N> displacements{};
+	uint32_t seed = 0;
+
+	constexpr StopWordTable(const char* const (&list)[N]) {
+		array<string_view, N> words{};
+		for (size_t i = 0; i < N; i += 1) {
+			words[i] = list[i];
+		}
+
+		array<int, N> slot_keys{}, bucket_start{}, bucket_keys{}, stamps{};
+		array<uint32_t, N> hashes{};
+		while (!build_perfect_hash(words, N, seed, slot_words, displacements, slot_keys, bucket_start, bucket_keys, stamps, hashes)) {
+			seed += 1;
+		}
+	}
+
+	constexpr bool contains(string_view word) const {
+		return perfect_hash_contains(slot_words, displacements, N, seed, word);
+	}
+};
+
+#ifdef HAS_STOP_WORD_LIST
+constexpr StopWordTable<sizeof(STOP_WORD_LIST) / sizeof(STOP_WORD_LIST[0])> STOP_WORD_TABLE(STOP_WORD_LIST);
+static_assert(STOP_WORD_TABLE.contains("the") && !STOP_WORD_TABLE.contains("virus"), "the stop word table is broken");
+#endif
+
+
+// The set of stop words shared by the index processor and the ranking processor. It uses the table compiled into the program
+// if there is one, otherwise the table is built when the stop word file is loaded
+class StopWordSet {
+
+private:
+	// Only used by a table built at run time
+	vector<string> storage;
+	vector<string_view> runtime_words;
+	vector<int> runtime_displacements;
+
+	const string_view* slot_words = nullptr;
+	const int* displacements = nullptr;
+	int num_words = 0;
+	uint32_t seed = 0;
+
+public:
+
+	StopWordSet() {
+#ifdef HAS_STOP_WORD_LIST
+		slot_words = STOP_WORD_TABLE.slot_words.data();
+		displacements = STOP_WORD_TABLE.displacements.data();
+		num_words = STOP_WORD_TABLE.slot_words.size();
+		seed = STOP_WORD_TABLE.seed;
+#endif
+	}
+
+	// The table points into its own vectors, so it can't be copied
+	StopWordSet(const StopWordSet&) = delete;
+	StopWordSet& operator=(const StopWordSet&) = delete;
+
+
+	// Reads a file with one stop word per line into words, sorted and without duplicates. Returns false if it can't be opened
+	static bool read_words(string file_path, vector<string>& words) {
+
+		ifstream stop_word_list_inFS(file_path);
+		if (!stop_word_list_inFS.is_open()) {
+			return false;
+		}
+
+		words.clear();
+		string stop_word;
+		while (!stop_word_list_inFS.eof()) {
+			getline(stop_word_list_inFS, stop_word);
+			words.push_back(stop_word);
+		}
+		stop_word_list_inFS.close();
+
+		sort(words.begin(), words.end());
+		words.erase(unique(words.begin(), words.end()), words.end());
+		return true;
+	}
+
+
+	// Whether a stop word file has exactly the words of the table, so a compiled table that wasn't regenerated after the file
+	// was edited can be caught. A file that can't be opened has nothing to compare
+	bool same_words(string file_path) const {
+		vector<string> words;
+		if (!read_words(file_path, words)) {
+			return true;
+		}
+		if (words.size() != num_words) {
+			return false;
+		}
+		for (int i = 0; i < words.size(); i += 1) {
+			if (!contains(words.at(i))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	// Builds the table from a file with one stop word per line. Returns false if the file can't be opened
+	bool load(string file_path) {
+
+		if (!read_words(file_path, storage)) {
+			return false;
+		}
+
+		int n = storage.size();
+		vector<string_view> words(storage.begin(), storage.end());
+		runtime_words.assign(n, string_view());
+		runtime_displacements.assign(n, 0);
+		vector<int> slot_keys(n), bucket_start(n), bucket_keys(n), stamps(n);
+		vector<uint32_t> hashes(n);
+
+		seed = 0;
+		while (!build_perfect_hash(words, n, seed, runtime_words, runtime_displacements, slot_keys, bucket_start, bucket_keys, stamps, hashes)) {
+			seed += 1;
+		}
+
+		slot_words = runtime_words.data();
+		displacements = runtime_displacements.data();
+		num_words = n;
+		return true;
+	}
+
+
+	// True if the table was compiled into the program
+	static bool is_compiled() {
+#ifdef HAS_STOP_WORD_LIST
+		return true;
+#else
+		return false;
+#endif
+	}
+
+
+	bool contains(string_view word) const {
+		return perfect_hash_contains(slot_words, displacements, num_words, seed, word);
+	}
+
+	int size() const {
+		return num_words;
+	}
+
+};
+
+
+#endif
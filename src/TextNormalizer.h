@@ -0,0 +1,248 @@
+#ifndef TEXTNORMALIZER_H
+#define TEXTNORMALIZER_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cctype>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>       // SSE2 and AVX2 intrinsics
+#endif
+
+using namespace std;
+
+
+// A token of a normalized text, the token is text.substr(offset, length)
+struct TokenView {
+	int offset;
+	int length;
+};
+
+
+// The TextNormalizer does the work of remove_punctuation(), to_lower() and tokenize() in one pass over the text.
+// Every byte is looked up in a table that says whether it is dropped (punctuation and digits), separates two tokens (a space)
+// or is kept, and kept bytes are lowercased as they are moved down over the dropped ones. The tokens are not copied out of
+// the text, instead their offset and length are written to a vector that is reused for every text.
+// On x86 the bytes are classified and lowercased 16 (SSE2) or 32 (AVX2) at a time, the widest kernel the CPU supports is
+// picked when the normalizer is created. Chunks without any punctuation or digits are stored back whole, and only the spaces
+// in them are visited to find the token boundaries.
+class TextNormalizer {
+
+public:
+	enum Kernel { SCALAR, SSE2, AVX2 };
+
+private:
+	enum ByteClass : unsigned char { KEEP, DROP, SEPARATOR };
+
+	ByteClass byte_class[256];
+	char lower[256];
+
+	vector<TokenView> tokens;
+	Kernel kernel = SCALAR;
+
+
+	// Ends the current token at end, where a separator is written, and starts the next one right after it
+	void end_token(int end, int& start) {
+		if (end > start) {
+			tokens.push_back(TokenView{start, end - start});
+		}
+		start = end + 1;
+	}
+
+	void normalize_scalar(char* str, int i, int len, int& out, int& start) {
+
+		for (; i < len; i += 1) {
+			unsigned char c = str[i];
+
+			switch (byte_class[c]) {
+				case KEEP:
+					str[out] = lower[c];
+					out += 1;
+					break;
+
+				case SEPARATOR:
+					end_token(out, start);
+					str[out] = ' ';
+					out += 1;
+					break;
+
+				case DROP:
+					break;
+			}
+		}
+	}
+
+	// Writes the n lowered bytes of one chunk to the output, skipping the ones set in drop and ending a token at the ones set in space
+	void normalize_chunk(char* str, const char* lowered, int n, unsigned int drop, unsigned int space, int& out, int& start) {
+
+		// Nothing to drop, the whole chunk is kept and only the spaces in it have to be visited
+		if (drop == 0) {
+			while (space != 0) {
+				end_token(out + __builtin_ctz(space), start);
+				space &= space - 1;
+			}
+			out += n;
+			return;
+		}
+
+		for (int j = 0; j < n; j += 1) {
+			unsigned int bit = 1u << j;
+			if (drop & bit) {
+				continue;
+			}
+			if (space & bit) {
+				end_token(out, start);
+			}
+			str[out] = lowered[j];
+			out += 1;
+		}
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+	// Sets the bytes of v that are in [lo, hi]. All the ranges we test are inside 1..127, so the signed compares are enough
+	// and the bytes >= 128 (UTF-8) are never in range
+	static __m128i in_range(__m128i v, char lo, char hi) {
+		return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+	}
+
+	__attribute__((target("sse2")))
+	int normalize_sse2(char* str, int len, int& out, int& start) {
+
+		int i = 0;
+		alignas(16) char lowered[16];
+
+		for (; i + 16 <= len; i += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*) (str + i));
+
+			__m128i upper = in_range(v, 'A', 'Z');
+			__m128i drop = _mm_or_si128(in_range(v, '!', '@'), _mm_or_si128(in_range(v, '[', '`'), in_range(v, '{', '~')));
+			__m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+			__m128i low = _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+
+			unsigned int drop_mask = _mm_movemask_epi8(drop);
+			unsigned int space_mask = _mm_movemask_epi8(space);
+
+			if (drop_mask == 0) {
+				// out <= i, so this never overwrites bytes that haven't been loaded yet
+				_mm_storeu_si128((__m128i*) (str + out), low);
+			}
+			else {
+				_mm_store_si128((__m128i*) lowered, low);
+			}
+			normalize_chunk(str, lowered, 16, drop_mask, space_mask, out, start);
+		}
+		return i;
+	}
+
+	__attribute__((target("avx2")))
+	static __m256i in_range_avx2(__m256i v, char lo, char hi) {
+		return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+	}
+
+	__attribute__((target("avx2")))
+	int normalize_avx2(char* str, int len, int& out, int& start) {
+
+		int i = 0;
+		alignas(32) char lowered[32];
+
+		for (; i + 32 <= len; i += 32) {
+			__m256i v = _mm256_loadu_si256((const __m256i*) (str + i));
+
+			__m256i upper = in_range_avx2(v, 'A', 'Z');
+			__m256i drop = _mm256_or_si256(in_range_avx2(v, '!', '@'), _mm256_or_si256(in_range_avx2(v, '[', '`'), in_range_avx2(v, '{', '~')));
+			__m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+			__m256i low = _mm256_add_epi8(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+
+			unsigned int drop_mask = _mm256_movemask_epi8(drop);
+			unsigned int space_mask = _mm256_movemask_epi8(space);
+
+			if (drop_mask == 0) {
+				_mm256_storeu_si256((__m256i*) (str + out), low);
+			}
+			else {
+				_mm256_store_si256((__m256i*) lowered, low);
+			}
+			normalize_chunk(str, lowered, 32, drop_mask, space_mask, out, start);
+		}
+		return i;
+	}
+
+#endif
+
+public:
+
+	TextNormalizer() {
+		for (int c = 0; c < 256; c += 1) {
+			if (c == ' ') {
+				byte_class[c] = SEPARATOR;
+			}
+			else if (ispunct(c) || isdigit(c)) {
+				byte_class[c] = DROP;
+			}
+			else {
+				byte_class[c] = KEEP;
+			}
+			lower[c] = tolower(c);
+		}
+
+		kernel = best_kernel();
+	}
+
+
+	// The widest kernel this CPU can run
+	static Kernel best_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+		if (__builtin_cpu_supports("avx2")) {
+			return AVX2;
+		}
+		if (__builtin_cpu_supports("sse2")) {
+			return SSE2;
+		}
+#endif
+		return SCALAR;
+	}
+
+	// Forces a kernel, used by the benchmarks. A kernel the CPU can't run falls back to the best one it can
+	void set_kernel(Kernel k) {
+		kernel = (k > best_kernel()) ? best_kernel() : k;
+	}
+
+	Kernel get_kernel() {
+		return kernel;
+	}
+
+
+	// Normalizes the text in place and returns its tokens. The tokens are only valid until the next call.
+	// The normalized text is the same as remove_punctuation() and to_lower() would leave, the tokens are separated by spaces
+	vector<TokenView>& normalize(string& text) {
+
+		tokens.clear();
+
+		char* str = &text[0];
+		int len = text.size();
+		int out = 0;      // where the next kept byte is written
+		int start = 0;    // where the current token starts
+		int i = 0;        // the bytes before i have been done by a SIMD kernel
+
+#if defined(__x86_64__) || defined(__i386__)
+		if (kernel == AVX2) {
+			i = normalize_avx2(str, len, out, start);
+		}
+		else if (kernel == SSE2) {
+			i = normalize_sse2(str, len, out, start);
+		}
+#endif
+		normalize_scalar(str, i, len, out, start);
+
+		end_token(out, start);
+
+		text.resize(out);
+		return tokens;
+	}
+
+};
+
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "DocumentTable.h"
+
+using namespace std;
+
+
+// TopK keeps the k best scored documents seen so far, in a min-heap of k entries whose top is the worst of them. A document
+// only goes in if it beats that one, so collecting n scores takes O(n log k) time and O(k) memory, whatever the number of
+// matches. Equal scores are ranked by document id (the smaller id first), so the results don't depend on the order the
+// documents are collected in
+class TopK {
+
+private:
+	struct Hit {
+		double score;
+		DocId doc;
+	};
+
+	int k;
+	vector<Hit> heap;
+
+	// Whether a ranks before b
+	static bool better(const Hit& a, const Hit& b) {
+		return a.score > b.score || (a.score == b.score && a.doc < b.doc);
+	}
+
+public:
+
+	TopK(int k) {
+		this->k = k;
+	}
+
+
+	void push(DocId doc, double score) {
+		Hit hit{score, doc};
+		if (heap.size() < k) {
+			heap.push_back(hit);
+			push_heap(heap.begin(), heap.end(), better);
+		}
+		else if (k > 0 && better(hit, heap.front())) {
+			// Replace the worst hit
+			pop_heap(heap.begin(), heap.end(), better);
+			heap.back() = hit;
+			push_heap(heap.begin(), heap.end(), better);
+		}
+	}
+
+
+	int size() const {
+		return heap.size();
+	}
+
+	// Whether k documents were collected, from then on a document needs to beat min_score() to get in
+	bool full() const {
+		return k > 0 && heap.size() == k;
+	}
+
+	// The score of the worst collected document
+	double min_score() const {
+		return heap.front().score;
+	}
+
+
+	// Appends the collected documents to out, the best one first
+	void get_results(vector<DocId>& out) const {
+		vector<Hit> sorted = heap;
+		sort_heap(sorted.begin(), sorted.end(), better);
+		for (int i = 0; i < sorted.size(); i += 1) {
+			out.push_back(sorted.at(i).doc);
+		}
+	}
+
+};
+
+
+#endif
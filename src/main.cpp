@@ -1,9 +1,27 @@
 
 #include "SearchEngine.h"
+#include "Benchmark.h"
 
 int main(int argc, char const *argv[]) {
 
-	SearchEngine();
+	// The number of threads used to build the index can be passed as the first argument, e.g. ./a.out 8
+	// The k1 and b parameters of the BM25 ranking can follow it, e.g. ./a.out 8 1.2 0.75, then the weight of the proximity
+	// boost, e.g. ./a.out 8 1.2 0.75 0 ranks without it
+	if (argc > 4) {
+		SearchEngine(atoi(argv[1]), atof(argv[2]), atof(argv[3]), atof(argv[4]));
+	}
+	else if (argc > 3) {
+		SearchEngine(atoi(argv[1]), atof(argv[2]), atof(argv[3]));
+	}
+	else if (argc > 2) {
+		SearchEngine(atoi(argv[1]), atof(argv[2]));
+	}
+	else if (argc > 1) {
+		SearchEngine(atoi(argv[1]));
+	}
+	else {
+		SearchEngine();
+	}
 
 	return 0;
 }
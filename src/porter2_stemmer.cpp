@@ -548,3 +548,457 @@ bool Porter2Stemmer::internal::containsVowel(const std::string& word,
     }
     return false;
 }
+
+/*
+  Stemming in place in a caller provided buffer.
+
+  This is the same algorithm as Porter2Stemmer::stem(), step for step, but the
+  word is a char buffer and its length, so no step allocates or copies the
+  word: suffixes are removed by shortening the length and replaced by
+  overwriting the tail of the buffer. The result is never longer than the
+  input (or 35 chars), so the caller's buffer only has to hold the input.
+
+  The suffix lists of steps 2 to 4 are tables that are scanned in the same
+  order as the std::string version (the first suffix that is found and in the
+  region wins), but an entry is only compared if its last char is the last
+  char of the word.
+*/
+namespace
+{
+using namespace Porter2Stemmer::internal;
+
+struct Suffix
+{
+    const char* suffix;
+    size_t len;
+    const char* replacement;
+    size_t replacementLen;
+};
+
+#define P2_SUFFIX(s, r) {s, sizeof(s) - 1, r, sizeof(r) - 1}
+
+const Suffix step2Subs[] = {P2_SUFFIX("ational", "ate"),
+                            P2_SUFFIX("tional", "tion"),
+                            P2_SUFFIX("enci", "ence"),
+                            P2_SUFFIX("anci", "ance"),
+                            P2_SUFFIX("abli", "able"),
+                            P2_SUFFIX("entli", "ent"),
+                            P2_SUFFIX("izer", "ize"),
+                            P2_SUFFIX("ization", "ize"),
+                            P2_SUFFIX("ation", "ate"),
+                            P2_SUFFIX("ator", "ate"),
+                            P2_SUFFIX("alism", "al"),
+                            P2_SUFFIX("aliti", "al"),
+                            P2_SUFFIX("alli", "al"),
+                            P2_SUFFIX("fulness", "ful"),
+                            P2_SUFFIX("ousli", "ous"),
+                            P2_SUFFIX("ousness", "ous"),
+                            P2_SUFFIX("iveness", "ive"),
+                            P2_SUFFIX("iviti", "ive"),
+                            P2_SUFFIX("biliti", "ble"),
+                            P2_SUFFIX("bli", "ble"),
+                            P2_SUFFIX("fulli", "ful"),
+                            P2_SUFFIX("lessli", "less")};
+
+const Suffix step3Subs[] = {P2_SUFFIX("ational", "ate"),
+                            P2_SUFFIX("tional", "tion"),
+                            P2_SUFFIX("alize", "al"),
+                            P2_SUFFIX("icate", "ic"),
+                            P2_SUFFIX("iciti", "ic"),
+                            P2_SUFFIX("ical", "ic"),
+                            P2_SUFFIX("ful", ""),
+                            P2_SUFFIX("ness", "")};
+
+const Suffix step4Subs[] = {P2_SUFFIX("al", ""),
+                            P2_SUFFIX("ance", ""),
+                            P2_SUFFIX("ence", ""),
+                            P2_SUFFIX("er", ""),
+                            P2_SUFFIX("ic", ""),
+                            P2_SUFFIX("able", ""),
+                            P2_SUFFIX("ible", ""),
+                            P2_SUFFIX("ant", ""),
+                            P2_SUFFIX("ement", ""),
+                            P2_SUFFIX("ment", ""),
+                            P2_SUFFIX("ism", ""),
+                            P2_SUFFIX("ate", ""),
+                            P2_SUFFIX("iti", ""),
+                            P2_SUFFIX("ous", ""),
+                            P2_SUFFIX("ive", ""),
+                            P2_SUFFIX("ize", "")};
+
+const Suffix exceptions[] = {P2_SUFFIX("skis", "ski"),
+                             P2_SUFFIX("skies", "sky"),
+                             P2_SUFFIX("dying", "die"),
+                             P2_SUFFIX("lying", "lie"),
+                             P2_SUFFIX("tying", "tie"),
+                             P2_SUFFIX("idly", "idl"),
+                             P2_SUFFIX("gently", "gentl"),
+                             P2_SUFFIX("ugly", "ugli"),
+                             P2_SUFFIX("early", "earli"),
+                             P2_SUFFIX("only", "onli"),
+                             P2_SUFFIX("singly", "singl")};
+
+#undef P2_SUFFIX
+
+bool equals(const char* word, size_t len, const char* str, size_t strLen)
+{
+    return len == strLen && std::equal(word, word + len, str);
+}
+
+bool endsWith(const char* word, size_t len, const char* str, size_t strLen)
+{
+    return len >= strLen && std::equal(word + len - strLen, word + len, str);
+}
+
+template <size_t N>
+bool endsWith(const char* word, size_t len, const char (&str)[N])
+{
+    return endsWith(word, len, str, N - 1);
+}
+
+bool replaceIfExists(char* word, size_t& len, const char* suffix,
+                     size_t suffixLen, const char* replacement,
+                     size_t replacementLen, size_t start)
+{
+    if (suffixLen > len)
+        return false;
+
+    size_t idx = len - suffixLen;
+    if (idx < start)
+        return false;
+
+    if (std::equal(word + idx, word + len, suffix))
+    {
+        std::copy(replacement, replacement + replacementLen, word + idx);
+        len = idx + replacementLen;
+        return true;
+    }
+    return false;
+}
+
+template <size_t N, size_t M>
+bool replaceIfExists(char* word, size_t& len, const char (&suffix)[N],
+                     const char (&replacement)[M], size_t start)
+{
+    return replaceIfExists(word, len, suffix, N - 1, replacement, M - 1,
+                           start);
+}
+
+// Replaces the first suffix of the table that ends the word and starts at or
+// after start
+template <size_t N>
+bool replaceFirst(char* word, size_t& len, const Suffix (&subs)[N],
+                  size_t start)
+{
+    if (len == 0)
+        return false;
+
+    char last = word[len - 1];
+    for (auto& sub : subs)
+    {
+        if (sub.suffix[sub.len - 1] != last)
+            continue;
+        if (replaceIfExists(word, len, sub.suffix, sub.len, sub.replacement,
+                            sub.replacementLen, start))
+            return true;
+    }
+    return false;
+}
+
+size_t firstNonVowelAfterVowel(const char* word, size_t len, size_t start)
+{
+    for (size_t i = start; i != 0 && i < len; ++i)
+    {
+        if (!isVowelY(word[i]) && isVowelY(word[i - 1]))
+            return i + 1;
+    }
+
+    return len;
+}
+
+size_t getStartR1(const char* word, size_t len)
+{
+    if (len >= 5 && std::equal(word, word + 5, "gener"))
+        return 5;
+    if (len >= 6 && std::equal(word, word + 6, "commun"))
+        return 6;
+    if (len >= 5 && std::equal(word, word + 5, "arsen"))
+        return 5;
+
+    return firstNonVowelAfterVowel(word, len, 1);
+}
+
+size_t getStartR2(const char* word, size_t len, size_t startR1)
+{
+    if (startR1 == len)
+        return startR1;
+
+    return firstNonVowelAfterVowel(word, len, startR1 + 1);
+}
+
+bool containsVowel(const char* word, size_t len, size_t start, size_t end)
+{
+    if (end <= len)
+    {
+        for (size_t i = start; i < end; ++i)
+            if (isVowelY(word[i]))
+                return true;
+    }
+    return false;
+}
+
+bool isShort(const char* word, size_t len)
+{
+    if (len >= 3)
+    {
+        if (!isVowelY(word[len - 3]) && isVowelY(word[len - 2])
+            && !isVowelY(word[len - 1]) && word[len - 1] != 'w'
+            && word[len - 1] != 'x' && word[len - 1] != 'Y')
+            return true;
+    }
+    return len == 2 && isVowelY(word[0]) && !isVowelY(word[1]);
+}
+
+bool endsInDouble(const char* word, size_t len)
+{
+    if (len >= 2)
+    {
+        char a = word[len - 1];
+        char b = word[len - 2];
+
+        if (a == b)
+            return a == 'b' || a == 'd' || a == 'f' || a == 'g' || a == 'm'
+                   || a == 'n' || a == 'p' || a == 'r' || a == 't';
+    }
+
+    return false;
+}
+
+bool special(char* word, size_t& len)
+{
+    for (auto& ex : exceptions)
+    {
+        if (equals(word, len, ex.suffix, ex.len))
+        {
+            std::copy(ex.replacement, ex.replacement + ex.replacementLen, word);
+            len = ex.replacementLen;
+            return true;
+        }
+    }
+
+    return len >= 3 && len <= 5
+           && (equals(word, len, "sky", 3) || equals(word, len, "news", 4)
+               || equals(word, len, "howe", 4) || equals(word, len, "atlas", 5)
+               || equals(word, len, "cosmos", 6) || equals(word, len, "bias", 4)
+               || equals(word, len, "andes", 5));
+}
+
+void changeY(char* word, size_t len)
+{
+    if (word[0] == 'y')
+        word[0] = 'Y';
+
+    for (size_t i = 1; i < len; ++i)
+    {
+        if (word[i] == 'y' && isVowel(word[i - 1]))
+            word[i++] = 'Y'; // skip next iteration
+    }
+}
+
+void step0(char* word, size_t& len)
+{
+    replaceIfExists(word, len, "'s'", "", 0)
+        || replaceIfExists(word, len, "'s", "", 0)
+        || replaceIfExists(word, len, "'", "", 0);
+}
+
+bool step1A(char* word, size_t& len)
+{
+    if (!replaceIfExists(word, len, "sses", "ss", 0))
+    {
+        if (endsWith(word, len, "ied") || endsWith(word, len, "ies"))
+        {
+            // if preceded by only one letter
+            if (len <= 4)
+                len -= 1;
+            else
+                len -= 2;
+        }
+        else if (endsWith(word, len, "s") && !endsWith(word, len, "us")
+                 && !endsWith(word, len, "ss"))
+        {
+            if (len > 2 && containsVowel(word, len, 0, len - 2))
+                len -= 1;
+        }
+    }
+
+    return (len == 6 || len == 7)
+           && (equals(word, len, "inning", 6) || equals(word, len, "outing", 6)
+               || equals(word, len, "canning", 7)
+               || equals(word, len, "herring", 7)
+               || equals(word, len, "earring", 7)
+               || equals(word, len, "proceed", 7)
+               || equals(word, len, "exceed", 6)
+               || equals(word, len, "succeed", 7));
+}
+
+void step1B(char* word, size_t& len, size_t startR1)
+{
+    bool exists = endsWith(word, len, "eedly") || endsWith(word, len, "eed");
+
+    if (exists)
+        replaceIfExists(word, len, "eedly", "ee", startR1)
+            || replaceIfExists(word, len, "eed", "ee", startR1);
+    else
+    {
+        size_t size = len;
+        bool deleted = (containsVowel(word, len, 0, size - 2)
+                        && replaceIfExists(word, len, "ed", "", 0))
+                       || (containsVowel(word, len, 0, size - 4)
+                           && replaceIfExists(word, len, "edly", "", 0))
+                       || (containsVowel(word, len, 0, size - 3)
+                           && replaceIfExists(word, len, "ing", "", 0))
+                       || (containsVowel(word, len, 0, size - 5)
+                           && replaceIfExists(word, len, "ingly", "", 0));
+
+        if (deleted && (endsWith(word, len, "at") || endsWith(word, len, "bl")
+                        || endsWith(word, len, "iz")))
+            word[len++] = 'e';
+        else if (deleted && endsInDouble(word, len))
+            len -= 1;
+        else if (deleted && startR1 == len && isShort(word, len))
+            word[len++] = 'e';
+    }
+}
+
+void step1C(char* word, size_t len)
+{
+    if (len > 2 && (word[len - 1] == 'y' || word[len - 1] == 'Y'))
+        if (!isVowel(word[len - 2]))
+            word[len - 1] = 'i';
+}
+
+void step2(char* word, size_t& len, size_t startR1)
+{
+    if (replaceFirst(word, len, step2Subs, startR1))
+        return;
+
+    if (!replaceIfExists(word, len, "logi", "log", startR1 - 1))
+    {
+        // make sure we choose the longest suffix
+        if (endsWith(word, len, "li") && !endsWith(word, len, "abli")
+            && !endsWith(word, len, "entli") && !endsWith(word, len, "aliti")
+            && !endsWith(word, len, "alli") && !endsWith(word, len, "ousli")
+            && !endsWith(word, len, "bli") && !endsWith(word, len, "fulli")
+            && !endsWith(word, len, "lessli"))
+            if (len > 3 && len - 2 >= startR1
+                && isValidLIEnding(word[len - 3]))
+                len -= 2;
+    }
+}
+
+void step3(char* word, size_t& len, size_t startR1, size_t startR2)
+{
+    if (replaceFirst(word, len, step3Subs, startR1))
+        return;
+
+    replaceIfExists(word, len, "ative", "", startR2);
+}
+
+void step4(char* word, size_t& len, size_t startR2)
+{
+    if (replaceFirst(word, len, step4Subs, startR2))
+        return;
+
+    // make sure we only choose the longest suffix
+    if (!endsWith(word, len, "ement") && !endsWith(word, len, "ment"))
+        if (replaceIfExists(word, len, "ent", "", startR2))
+            return;
+
+    // short circuit
+    replaceIfExists(word, len, "sion", "s", startR2 - 1)
+        || replaceIfExists(word, len, "tion", "t", startR2 - 1);
+}
+
+void step5(char* word, size_t& len, size_t startR1, size_t startR2)
+{
+    if (len == 0)
+        return;
+
+    size_t size = len;
+    if (word[size - 1] == 'e')
+    {
+        if (size - 1 >= startR2)
+            len -= 1;
+        else if (size - 1 >= startR1 && !isShort(word, size - 1))
+            len -= 1;
+    }
+    else if (word[len - 1] == 'l')
+    {
+        if (len - 1 >= startR2 && word[len - 2] == 'l')
+            len -= 1;
+    }
+}
+
+void replaceY(char* word, size_t len)
+{
+    std::replace(word, word + len, 'Y', 'y');
+}
+}
+
+size_t Porter2Stemmer::stem(char* word, size_t len)
+{
+    // special case short words or sentence tags
+    if (len <= 2 || equals(word, len, "<s>", 3) || equals(word, len, "</s>", 4))
+        return len;
+
+    // max word length is 35 for English
+    if (len > 35)
+        len = 35;
+
+    if (word[0] == '\'')
+    {
+        std::copy(word + 1, word + len, word);
+        len -= 1;
+    }
+
+    if (special(word, len))
+        return len;
+
+    changeY(word, len);
+    size_t startR1 = getStartR1(word, len);
+    size_t startR2 = getStartR2(word, len, startR1);
+
+    step0(word, len);
+
+    if (step1A(word, len))
+    {
+        replaceY(word, len);
+        return len;
+    }
+
+    step1B(word, len, startR1);
+    step1C(word, len);
+    step2(word, len, startR1);
+    step3(word, len, startR1, startR2);
+    step4(word, len, startR2);
+    step5(word, len, startR1, startR2);
+
+    replaceY(word, len);
+    return len;
+}
+
+size_t Porter2Stemmer::trim(char* word, size_t len)
+{
+    if (equals(word, len, "<s>", 3) || equals(word, len, "</s>", 4))
+        return len;
+
+    size_t out = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        char ch = ::tolower(word[i]);
+        if ((ch >= 'a' && ch <= 'z') || ch == '\'')
+            word[out++] = ch;
+    }
+    return out;
+}
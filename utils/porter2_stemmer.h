@@ -40,6 +40,19 @@ void stem(std::string& word);
 
 void trim(std::string& word);
 
+/**
+ * Stems the word in word[0, len) in place, without allocating.
+ * @return the length of the stem, which is never more than len
+ */
+size_t stem(char* word, size_t len);
+
+/**
+ * Lowercases the word in word[0, len) in place and removes every char that is
+ * not a letter or an apostrophe, without allocating.
+ * @return the length of the trimmed word
+ */
+size_t trim(char* word, size_t len);
+
 namespace internal
 {
 size_t firstNonVowelAfterVowel(const std::string& word, size_t start);
@@ -7,12 +7,15 @@
  *
  * Words are read from the file diffs.txt
  *  (from http://snowball.tartarus.org/algorithms/english/diffs.txt)
- *  and compared against the correct output.
+ *  and compared against the correct output, once with the std::string
+ *  stemmer and once with the in place char buffer stemmer.
  */
 
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <utility>
 #include <chrono>
 #include "porter2_stemmer.h"
 
@@ -21,30 +24,57 @@ int main()
     std::ifstream in{"diffs.txt"};
     std::string to_stem;
     std::string stemmed;
+    std::vector<std::pair<std::string, std::string>> words;
+    while (in >> to_stem >> stemmed)
+        words.emplace_back(to_stem, stemmed);
+
     bool mistake = false;
     using timer = std::chrono::high_resolution_clock;
+
     timer::time_point start_time = timer::now();
-    while (in >> to_stem >> stemmed)
+    for (auto& word : words)
     {
-        std::string orig = to_stem;
+        to_stem = word.first;
         Porter2Stemmer::trim(to_stem);
         Porter2Stemmer::stem(to_stem);
-        if (to_stem != stemmed)
+        if (to_stem != word.second)
         {
             std::cout << "  incorrect!" << std::endl
                       << std::endl
-                      << "to stem:  " << orig    << std::endl
-                      << "stemmed:  " << to_stem << std::endl
-                      << "expected: " << stemmed << std::endl;
+                      << "to stem:  " << word.first  << std::endl
+                      << "stemmed:  " << to_stem     << std::endl
+                      << "expected: " << word.second << std::endl;
             mistake = true;
         }
     }
     timer::time_point end_time = timer::now();
 
+    char buffer[256];
+    timer::time_point buffer_start_time = timer::now();
+    for (auto& word : words)
+    {
+        size_t len = word.first.copy(buffer, sizeof(buffer));
+        len = Porter2Stemmer::trim(buffer, len);
+        len = Porter2Stemmer::stem(buffer, len);
+        if (word.second.compare(0, std::string::npos, buffer, len) != 0)
+        {
+            std::cout << "  incorrect (buffer)!" << std::endl
+                      << std::endl
+                      << "to stem:  " << word.first  << std::endl
+                      << "stemmed:  " << std::string(buffer, len) << std::endl
+                      << "expected: " << word.second << std::endl;
+            mistake = true;
+        }
+    }
+    timer::time_point buffer_end_time = timer::now();
+
     if (!mistake)
         std::cout << "Passed all tests!" << std::endl;
 
-    std::cout << "Time elapsed: "
-              << std::chrono::duration_cast<std::chrono::milliseconds>(
-                     end_time - start_time).count() << "ms" << std::endl;
+    std::cout << "Time elapsed (std::string): "
+              << std::chrono::duration_cast<std::chrono::microseconds>(
+                     end_time - start_time).count() << "us" << std::endl;
+    std::cout << "Time elapsed (char buffer): "
+              << std::chrono::duration_cast<std::chrono::microseconds>(
+                     buffer_end_time - buffer_start_time).count() << "us" << std::endl;
 }